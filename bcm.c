@@ -0,0 +1,163 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "isrstat.h"
+#include "bcm.h"
+
+STATIC_ASSERT( _STM8_BCM_UNIT * 128 <= 65536, "BCM frame rate too low for TIM1 without prescaler" );
+STATIC_ASSERT( _STM8_BCM_UNIT >= 40 + 10 * _STM8_BCM_PORTS, "BCM frame rate too high" );
+
+#if defined(__ICCSTM8__)
+
+# define _STM8_BCM_IRQ_VECTOR    TIM1_OVR_UIF_vector
+# define _STM8_BCM_CR1           TIM1_CR1       // CEN 0x01, ARPE 0x80
+# define _STM8_BCM_IER           TIM1_IER       // UIE 0x01
+# define _STM8_BCM_SR1           TIM1_SR1       // UIF 0x01
+# define _STM8_BCM_EGR           TIM1_EGR       // UG 0x01
+# define _STM8_BCM_PSCRH         TIM1_PSCRH
+# define _STM8_BCM_PSCRL         TIM1_PSCRL
+# define _STM8_BCM_ARRH          TIM1_ARRH
+# define _STM8_BCM_ARRL          TIM1_ARRL
+# define _STM8_BCM_CGR           CLK_PCKENR1    // clock gating register
+# define _STM8_BCM_CGR_MASK      (1<<7)
+
+#else // check for STM's system header defines
+
+# define _STM8_BCM_IRQ_VECTOR    _Pragma("error Unsupported compiler")
+# define _STM8_BCM_CR1           TIM1->CR1
+# define _STM8_BCM_IER           TIM1->IER
+# define _STM8_BCM_SR1           TIM1->SR1
+# define _STM8_BCM_EGR           TIM1->EGR
+# define _STM8_BCM_PSCRH         TIM1->PSCRH
+# define _STM8_BCM_PSCRL         TIM1->PSCRL
+# define _STM8_BCM_ARRH          TIM1->ARRH
+# define _STM8_BCM_ARRL          TIM1->ARRL
+# define _STM8_BCM_CGR           CLK->PCKENR1
+# define _STM8_BCM_CGR_MASK      (1<<7)
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+static volatile uint8_t * _stm8_bcm_odr[ _STM8_BCM_PORTS ];
+static uint8_t _stm8_bcm_mask[ _STM8_BCM_PORTS ];
+
+// bitplane k of port i: the pins with bit k set in their duty value
+static uint8_t _stm8_bcm_plane[ _STM8_BCM_PORTS ][ 8 ];
+
+// stands in for the ODR of slots not attached
+static uint8_t _stm8_bcm_unused;
+
+// the bitplane being shown
+static TINY uint8_t _stm8_bcm_k = 0;
+
+_EXTERN_C
+
+// At the update event, bitplane k starts, and the preloaded auto-reload
+// (written one interrupt earlier) already holds its length. Write the
+// outputs, then preload the length of bitplane k+1.
+OPTIMIZE_SPEED
+INTERRUPT( _STM8_BCM_IRQ_VECTOR )
+void _stm8_bcm_update(void)
+{
+  ISR_ENTER( _STM8_BCM_IRQ_VECTOR );
+
+  const uint8_t k = _stm8_bcm_k;
+  for( uint8_t i=0; i<_STM8_BCM_PORTS; ++i)
+  {
+    volatile uint8_t * const odr = _stm8_bcm_odr[i];
+    *odr = ( *odr & ~_stm8_bcm_mask[i] ) | _stm8_bcm_plane[i][k];
+  }
+
+  const uint8_t next = ( k + 1 ) & 7;
+  // 16-bit shift, the unit is uint32_t and a variable 32-bit shift is a loop
+  const uint16_t arr = (uint16_t)( (uint16_t)_STM8_BCM_UNIT << next ) - 1;
+  _STM8_BCM_ARRH = arr >> 8;            // always access H first, L second.
+  _STM8_BCM_ARRL = arr;
+  _stm8_bcm_k = next;
+
+  _STM8_BCM_SR1 &= ~0x01;               // UIF=0x01, clear flag
+
+  ISR_EXIT( _STM8_BCM_IRQ_VECTOR );
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS   // interrupts are disabled during execution
+void _STM8_F(bcm_port)(uint8_t i, volatile uint8_t * odr, uint8_t mask)
+{
+  if( i >= _STM8_BCM_PORTS ) return;
+  _stm8_bcm_odr[i] = odr;
+  _stm8_bcm_mask[i] = mask;
+  for( uint8_t k=0; k<8; ++k) _stm8_bcm_plane[i][k] &= mask;
+}
+
+// Each plane byte is changed with a single BSET/BRES-like write, so the
+// interrupt handler sees the old or the new bit, and at worst shows one
+// frame with a mix of the old and new duty value.
+OPTIMIZE_SPEED
+void _STM8_F(bcm_write)(uint8_t i, uint8_t bit, uint8_t duty)
+{
+  if( i >= _STM8_BCM_PORTS ) return;
+  const uint8_t m = ( 1 << bit ) & _stm8_bcm_mask[i];
+  uint8_t * plane = _stm8_bcm_plane[i];
+  for( uint8_t k=0; k<8; ++k, duty >>= 1)
+  {
+    if( duty & 1 ) plane[k] |= m;
+    else           plane[k] &= ~m;
+  }
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(bcm_start)(void)
+{
+  // Peripheral clock gating register
+  _STM8_BCM_CGR |= _STM8_BCM_CGR_MASK;
+
+  for( uint8_t i=0; i<_STM8_BCM_PORTS; ++i)
+    if( !_stm8_bcm_odr[i] ) _stm8_bcm_odr[i] = &_stm8_bcm_unused;
+
+  _STM8_BCM_PSCRH = 0;                  // no prescaler, i.e. fMaster/1
+  _STM8_BCM_PSCRL = 0;
+  _STM8_BCM_ARRH = ( _STM8_BCM_UNIT - 1 ) >> 8;
+  _STM8_BCM_ARRL = ( _STM8_BCM_UNIT - 1 );
+  _stm8_bcm_k = 0;
+
+  _STM8_BCM_CR1 |= 0x80;                // ARPE=0x80, preload auto-reload
+  _STM8_BCM_EGR = 0x01;                 // UG=0x01, load ARR and prescaler
+  _STM8_BCM_SR1 &= ~0x01;               // UIF=0x01, clear the update from UG
+  _STM8_BCM_IER |= 0x01;                // UIE=0x01, Enable Update Interrupt
+  _STM8_BCM_CR1 |= 0x01;                // CEN=0x01, Enable Timer
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(bcm_stop)(void)
+{
+  _STM8_BCM_CR1 &= ~0x01;               // CEN=0x01, Disable Timer
+  _STM8_BCM_IER &= ~0x01;
+}
+
+_END_EXTERN_C
@@ -0,0 +1,96 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_BCM_H
+#define __STM8HAL_BCM_H
+
+#include "pin.h"
+#include "math.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SOFTWARE PWM BY BINARY CODE MODULATION (BIT ANGLE MODULATION)
+//
+// Each of the 8 bits of a duty value is shown for a time proportional to its
+// weight, 1, 2, 4 .. 128 units per frame of 255 units. The duty values are
+// kept as 8 bitplanes per port, so every interrupt writes one precomputed
+// byte per port, a read-modify-write of ODR limited to the port's BCM pins.
+// The cost per interrupt is the same for 1 or 8 pins on a port.
+//
+// TIM1 runs the modulation, as TIM4/6 keeps the millisecond tick and TIM2/5
+// the debug.h cycle counter; its auto-reload is preloaded, so the length of
+// the next bitplane is set while the current one is shown.
+//
+//   F_CPU 16MHz, 200Hz frame: unit = 313 cycles, 8 interrupts per frame
+//
+// The shortest bitplane must cover the interrupt handler (~30 cycles plus
+// ~10 per port), the frame rate is limited accordingly (static_assert).
+//
+// NOTE: As the handler rewrites ODR of a BCM port, a multi-bit read-modify-
+//       write of that port in the main loop (PinGroup<>::hi()/write(),
+//       digitalWrite() with a runtime pin, a plain ODR |= x) that is
+//       interrupted between its read and write puts the previous bitplane
+//       back, which then holds for up to 128 units: visible flicker. Change
+//       other pins on a BCM port only with single-bit BSET/BRES, i.e.
+//       FastPin<>::hi()/lo(), or with interrupts masked.
+
+#ifndef _STM8_BCM_PORTS
+#define _STM8_BCM_PORTS         2
+#endif
+
+#ifndef _STM8_BCM_FRAME_HZ
+#define _STM8_BCM_FRAME_HZ      200
+#endif
+
+// timer counts for the least significant bit
+#define _STM8_BCM_UNIT          ( (F_CPU) / ( (uint32_t)(_STM8_BCM_FRAME_HZ) * 255UL ) )
+
+_EXTERN_C
+
+// Assign the pins given by mask on the port with the output data register
+// odr to port slot i (0.._STM8_BCM_PORTS-1). The pins must be outputs.
+void _STM8_F(bcm_port)(uint8_t i, volatile uint8_t * odr, uint8_t mask);
+
+// Set the duty cycle (0..255) of pin bit (0..7) in port slot i.
+void _STM8_F(bcm_write)(uint8_t i, uint8_t bit, uint8_t duty);
+
+// Start/stop TIM1 and the modulation; stop leaves the pins as they are.
+void _STM8_F(bcm_start)(void);
+void _STM8_F(bcm_stop)(void);
+
+_END_EXTERN_C
+
+#ifdef __cplusplus
+
+// Set the duty cycle of a FastPin, its port being attached to slot i.
+template<uint8_t PIN>
+ALWAYS_INLINE
+inline void _STM8_F(bcm_pin)(uint8_t i, uint8_t duty)
+{
+  _STM8_F(bcm_write)( i, _STM8_F(log2)( FastPin<PIN>::mask() ), duty );
+}
+
+#endif // __cplusplus
+
+#endif // __STM8HAL_BCM_H
@@ -0,0 +1,80 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "debug.h"
+#include "isrstat.h"
+
+volatile uint16_t _stm8_cycles_hi = 0;
+
+_EXTERN_C
+
+// Interrupt handler for the TIM2/5 update, the upper word of cycles32()
+OPTIMIZE_SPEED
+INTERRUPT( _STM8_CYCLES_IRQ_VECTOR )
+void _stm8_cycles_update(void)
+{
+  ISR_ENTER( _STM8_CYCLES_IRQ_VECTOR );
+  // the counter started at 0 with the update event
+  ISR_LATENCY( _STM8_CYCLES_IRQ_VECTOR, _stm8_isr_start );  // see ISR_ENTER
+
+  ++_stm8_cycles_hi;
+  _STM8_CYCLES_SR1 = (uint8_t)~0x01;    // UIF=0x01, clear flag; rc_w0, leaves CCnIF alone
+
+  ISR_EXIT( _STM8_CYCLES_IRQ_VECTOR );
+}
+
+OPTIMIZE_SIZE
+void enableCycleCounter32(void)
+{
+  enableCycleCounter();
+  _STM8_CYCLES_SR1 = (uint8_t)~0x01;    // UIF=0x01, clear any pending update
+  _STM8_CYCLES_IER |= 0x01;             // UIE=0x01, Enable Update Interrupt
+}
+
+// As micros32(): with interrupts disabled, a set UIF means the upper word is
+// one behind. The wrap may have come just after lo was read, so with UIF set
+// the counter is read again, which is then surely past the wrap. This holds
+// however long interrupts were masked, up to a full 65536 cycles.
+OPTIMIZE_SPEED
+NO_INTERRUPTS   // interrupts are disabled during execution
+uint32_t _STM8_F(cycles32)(void)
+{
+  uint16_t lo = _STM8_F(cycles16)();
+  uint16_t hi = _stm8_cycles_hi;
+  if( _STM8_CYCLES_SR1 & 0x01 )
+  {
+    lo = _STM8_F(cycles16)();
+    ++hi;
+  }
+
+  _STM8_T(reg32) r;
+  r.w[0] = hi;                          // big endian
+  r.w[1] = lo;
+  return r.value;
+}
+
+_END_EXTERN_C
@@ -46,6 +46,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 # define _STM8_CYCLES_ARRH        _GLUE( _STM8_CYCLES, _ARRH )
 # define _STM8_CYCLES_ARRL        _GLUE( _STM8_CYCLES, _ARRL )
 # define _STM8_CYCLES_CR1         _GLUE( _STM8_CYCLES, _CR1 )  // CEN 0x01
+# define _STM8_CYCLES_IER         _GLUE( _STM8_CYCLES, _IER )  // UIE 0x01
+# define _STM8_CYCLES_SR1         _GLUE( _STM8_CYCLES, _SR1 )  // UIF 0x01
+# define _STM8_CYCLES_IRQ_VECTOR  _GLUE( _STM8_CYCLES, _OVR_UIF_vector )
 
   // TODO: These are highly variable between the different lines
   // TIM4/6 always seem to use the same values. check for TIM 2/5
@@ -72,6 +75,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 # define _STM8_CYCLES_ARRH        _GLUE( _STM8_CYCLES, ->ARRH )
 # define _STM8_CYCLES_ARRL        _GLUE( _STM8_CYCLES, ->ARRL )
 # define _STM8_CYCLES_CR1         _GLUE( _STM8_CYCLES, ->CR1 )   // CEN 0x01
+# define _STM8_CYCLES_IER         _GLUE( _STM8_CYCLES, ->IER )   // UIE 0x01
+# define _STM8_CYCLES_SR1         _GLUE( _STM8_CYCLES, ->SR1 )   // UIF 0x01
+# define _STM8_CYCLES_IRQ_VECTOR  _Pragma("error Unsupported compiler")
 
 # define _STM8_CYCLES_CGR         CLK_PCKENR1
 # define _STM8_CYCLES_CGR_MASK    (1<<5)
@@ -91,4 +97,50 @@ inline void enableCycleCounter()
   _STM8_CYCLES_CR1 |= 0x01;     // CEN=0x01, Enable Timer
 }
 
+// Read the free running counter. CNTRH must be read first: it latches CNTRL,
+// so both bytes belong to the same count. 4 cycles, LD A,hi / LD A,lo.
+OPTIMIZE_SPEED
+ALWAYS_INLINE
+inline uint16_t _STM8_F(cycles16)()
+{
+  const uint8_t hi = _STM8_CYCLES_CNTRH;
+  return ( (uint16_t)hi << 8 ) | _STM8_CYCLES_CNTRL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// EXTENDED 32-BIT CYCLE COUNTER, see cycles.c
+//
+// The update interrupt of TIM2/5 counts the wraps of the 16-bit counter
+// (every 65536 cycles, ~4ms at 16MHz) in the upper word. cycles32() wraps
+// after 2^32 cycles, ~268s at 16MHz.
+
+_EXTERN_C
+
+extern volatile uint16_t _stm8_cycles_hi;
+
+// enableCycleCounter() plus the update interrupt
+void enableCycleCounter32(void);
+
+// Consistent read of the 32-bit count, also with the update pending.
+uint32_t _STM8_F(cycles32)(void);
+
+_END_EXTERN_C
+
+// Cycles since start (a previous cycles32()), e.g. for the latency from
+// an event to its handling, or the duration of an operation.
+OPTIMIZE_SIZE
+ALWAYS_INLINE
+inline uint32_t _STM8_F(cycles_since)(uint32_t start)
+{
+  return _STM8_F(cycles32)() - start;
+}
+
+// Cycles to micro seconds, F_CPU a multiple of 1MHz.
+#define _STM8_CYCLES_TO_US(cycles) ( (cycles) / ( (F_CPU) / 1000000UL ) )
+
+#ifndef cycles32
+#define cycles32() _STM8_F(cycles32)()
+#endif
+
 #endif  // __STM8HAL_DEBUG_H
\ No newline at end of file
@@ -26,6 +26,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "stm8hal.h"
 #include "timer.h"
 #include "delay.h"
+#include "load.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -60,23 +61,70 @@ void _STM8_F(delay_us_cycles16)(volatile uint16_t wait_us)
 //  DELAY FUNCTIONS - BASED ON TIMER / INTERRUPTS
 //
 
+// With _STM8_DELAY_WFI, the core halts (WFI) between the timer interrupts
+// instead of spinning. WFI re-enables interrupts as it halts, so checking the
+// time with interrupts disabled and then executing WFI can't miss a tick.
+// The CPU clock stops while peripherals keep running, which takes the core
+// current out of long waits; wfi() also returns for any other interrupt.
+// NOTE: delay_us16 only halts while more than a full tick remains, the rest
+//       is spent spinning on micros16() to keep the microsecond resolution.
+// The interrupt state is restored on return. Called with interrupts
+// disabled, the delays don't halt (WFI would enable them) but spin.
+
+//uncomment to halt the core between timer interrupts during delays
+//#define _STM8_DELAY_WFI
+
+// CC I1 and I0 both set: interrupts disabled
+#define _STM8_DELAY_MASKED(state) ( ( (state) & 0x28 ) == 0x28 )
+
 OPTIMIZE_SIZE
 NO_INLINE
 void _STM8_F(delay_ms16)(uint16_t wait_ms)
 {
-  // TODO: feed the dog? wdg();
-  // TODO: define a weak void yield();  ???
+  // yield() runs other protothreads with _STM8_PT_YIELD, see pt.h
   const uint16_t start = _STM8_F(millis16)();
-  do { /* nothing */ } while( ((uint16_t)( _STM8_F(millis16)() - start)) < wait_ms);
+#ifdef _STM8_DELAY_WFI
+  const __istate_t state = __get_interrupt_state();
+  if( !_STM8_DELAY_MASKED(state) )
+  {
+    for(;;)
+    {
+      wdg();
+      yield();
+      disableInterrupts();
+      if( ((uint16_t)( _STM8_F(millis16)() - start)) >= wait_ms ) break;
+      LOAD_WFI();                       // enables interrupts, halts until one
+    }
+    __set_interrupt_state(state);
+  }
+#endif
+  while( ((uint16_t)( _STM8_F(millis16)() - start)) < wait_ms ) { wdg(); yield(); }
 }
 
 OPTIMIZE_SIZE
 NO_INLINE
 void _STM8_F(delay_us16)(uint16_t wait_us)
 {
-  // TODO: feed the dog? wdg();
+  // NOTE: with _STM8_PT_YIELD, the delay is 'at least' wait_us
   const uint16_t start = _STM8_F(micros16)();
-  do { /* nothing */ } while( ((uint16_t)( _STM8_F(micros16)() - start)) < wait_us);
+#ifdef _STM8_DELAY_WFI
+  const __istate_t state = __get_interrupt_state();
+  if( !_STM8_DELAY_MASKED(state) )
+  {
+    for(;;)
+    {
+      wdg();
+      yield();
+      disableInterrupts();
+      // the next tick is at most 1000us away, don't sleep past the deadline
+      const uint16_t elapsed = _STM8_F(micros16)() - start;
+      if( elapsed >= wait_us || wait_us - elapsed <= 1000 ) break;
+      LOAD_WFI();
+    }
+    __set_interrupt_state(state);
+  }
+#endif
+  do { wdg(); yield(); } while( ((uint16_t)( _STM8_F(micros16)() - start)) < wait_us);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
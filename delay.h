@@ -50,14 +50,29 @@ extern void _STM8_F(delay_256cycles)();
 // 24 cycles minimum - use NOPs for shorter periods.
 extern void _STM8_F(delay_cycles)(uint16_t wait_cycles);
 
+// Short variable delays by a computed jump into a NOP sled, call included.
+// Cycle exact from _STM8_DELAY_SHORT_MIN to MIN+SLED, longer or shorter
+// requests are clamped to that range. Only A and X are used. The minimum is
+// counted from the instruction timings (LD A,#n and CALL included); return
+// to a NOP, as above, if the caller's next instruction may stall.
+#ifndef _STM8_DELAY_SHORT_MIN
+#define _STM8_DELAY_SHORT_MIN   18      // see delay_cycles_short.asm
+#endif
+#ifndef _STM8_DELAY_SHORT_SLED
+#define _STM8_DELAY_SHORT_SLED  32      // max 64
+#endif
+
+extern void _STM8_F(delay_cycles_short)(uint8_t wait_cycles);
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // DELAY FUNCTIONS - CYCLES VARIABLE, SPECIFIED IN MICRO SECONDS
 //
 
-// TODO: Calibrate !!!
+// NOTE: These assume 16 cycles per micro second, i.e. F_CPU = 16MHz.
+//       For constant delays at any clock, use delay_us_const(N) /
+//       delay_ns_const(N).
 
-// 16MHz, 16 cycles ~ 1us
 NO_INLINE
 void _STM8_F(delay_us_cycles8)(uint8_t wait_us);
 NO_INLINE
@@ -107,7 +122,7 @@ _END_EXTERN_C
 // Any other instruction that is split over two long memory words
 // can also cause a pipeline stall, unless it is prefixed with a
 // NOP instruction.
-#define min_(a,b) ( (a) > (b) ? (a) : (b) )
+#define max_(a,b) ( (a) > (b) ? (a) : (b) )
 template<int16_t CYCLES>
 __attribute__((always_inline))
 inline void _STM8_F(nops)(bool cc=false)
@@ -115,22 +130,22 @@ inline void _STM8_F(nops)(bool cc=false)
   if( CYCLES > 64 ) // allow these to be followed by a single true NOP
   {
     _STM8_F(delay_64cycles)();
-    _STM8_F(nops)< min_(0,CYCLES-64) >(cc);
+    _STM8_F(nops)< max_(0,CYCLES-64) >(cc);
   }
   else if( CYCLES > 32 ) // allow these to be followed by a single true NOP
   {
     _STM8_F(delay_32cycles)();
-    _STM8_F(nops)< min_(0,CYCLES-32) >(cc);
+    _STM8_F(nops)< max_(0,CYCLES-32) >(cc);
   }
   else if( CYCLES > 16 ) // allow these to be followed by a single true NOP
   {
     _STM8_F(delay_16cycles)();
-    _STM8_F(nops)< min_(0,CYCLES-16) >(cc);
+    _STM8_F(nops)< max_(0,CYCLES-16) >(cc);
   }
   else if( CYCLES > 9 ) // allow these to be followed by a single true NOP
   {
     _STM8_F(delay_8cycles)();
-    _STM8_F(nops)< min_(0,CYCLES-8) >(cc);
+    _STM8_F(nops)< max_(0,CYCLES-8) >(cc);
   }
   else //if( CYCLES > 1)
   {
@@ -138,7 +153,7 @@ inline void _STM8_F(nops)(bool cc=false)
     if(! cc) asm("PUSH CC");
     else asm("TNZW X");
     //else asm("NOP \n NOP");
-    _STM8_F(nops)< min_(0,even-2) >(true);
+    _STM8_F(nops)< max_(0,even-2) >(true);
     if(! cc) asm("POP CC");
     _STM8_F(nops)< CYCLES-even >(cc);
   }
@@ -146,7 +161,79 @@ inline void _STM8_F(nops)(bool cc=false)
 }
 template<> __attribute__((always_inline)) inline void _STM8_F(nops)<0>(bool) {}
 template<> __attribute__((always_inline)) inline void _STM8_F(nops)<1>(bool) { nop(); }
-#undef min_
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// DELAY FUNCTIONS - CONSTANT, CALIBRATED FROM F_CPU AT COMPILE TIME
+//
+// delay_ns_const(N) and delay_us_const(N), i.e. _STM8_F(delay_ns)<N>() and
+// _STM8_F(delay_us)<N>(), wait at least N ns/us for a constant N, rounded up
+// to whole cycles. Short delays are inlined as NOP/TNZW sequences and calls
+// into the fixed delay_Ncycles chain (nops<>), longer ones call
+// delay_cycles(), which takes 24 cycles or more, call included.
+//
+// Use delay_ms() for anything beyond a few milliseconds; every 65535
+// cycles add another call.
+
+#ifndef _STM8_DELAY_NOPS_MAX
+#define _STM8_DELAY_NOPS_MAX    40      // max cycles for nops<>
+#endif
+
+// anything longer goes to delay_cycles(), which can't do less than 24
+STATIC_ASSERT( _STM8_DELAY_NOPS_MAX >= 23, "_STM8_DELAY_NOPS_MAX must cover what delay_cycles() can't" );
+
+template<uint32_t CYCLES>
+__attribute__((always_inline))
+inline void _STM8_F(delay_const)()
+{
+  if( CYCLES <= _STM8_DELAY_NOPS_MAX )
+  {
+    _STM8_F(nops)< (int16_t)( CYCLES <= _STM8_DELAY_NOPS_MAX ? CYCLES : 0 ) >();
+  }
+  else if( CYCLES <= 0xFFFF )
+  {
+    _STM8_F(delay_cycles)( (uint16_t)CYCLES );
+  }
+  else
+  {
+    _STM8_F(delay_cycles)( 0xFFFF );
+    _STM8_F(delay_const)< ( CYCLES > 0xFFFF ? CYCLES - 0xFFFF : 0 ) >();
+  }
+}
+template<> __attribute__((always_inline)) inline void _STM8_F(delay_const)<0>() {}
+
+// cycles for N ns at F_CPU, rounded up; the product is 32-bit, so N is
+// limited to ~179us at 24MHz, see the asserts below
+#define _STM8_NS_TO_CYCLES(ns) \
+  ( ( (uint32_t)(ns) * ( (F_CPU) / 1000UL ) + 999999UL ) / 1000000UL )
+#define _STM8_US_TO_CYCLES(us) \
+  ( ( (uint32_t)(us) * ( (F_CPU) / 1000UL ) + 999UL ) / 1000UL )
+
+template<uint32_t NS>
+__attribute__((always_inline))
+inline void _STM8_F(delay_ns)()
+{
+  STATIC_ASSERT( NS <= ( 0xFFFFFFFFUL - 999999UL ) / ( (F_CPU) / 1000UL ), "delay_ns_const: use delay_us_const" );
+  _STM8_F(delay_const)< _STM8_NS_TO_CYCLES(NS) >();
+}
+
+template<uint32_t US>
+__attribute__((always_inline))
+inline void _STM8_F(delay_us)()
+{
+  STATIC_ASSERT( US <= ( 0xFFFFFFFFUL - 999UL ) / ( (F_CPU) / 1000UL ), "delay_us_const: use delay_ms" );
+  _STM8_F(delay_const)< _STM8_US_TO_CYCLES(US) >();
+}
+
+#ifndef delay_ns_const
+#define delay_ns_const(ns) _STM8_F(delay_ns)< (ns) >()
+#endif
+
+#ifndef delay_us_const
+#define delay_us_const(us) _STM8_F(delay_us)< (us) >()
+#endif
+
+#undef max_
 
 #endif // __cplusplus
 
@@ -0,0 +1,69 @@
+#include "vregs.inc"
+
+#define _STM8HAL_INTERNAL
+#include "stm8hal.h"
+
+; keep in sync with delay.h
+#ifndef _STM8_DELAY_SHORT_MIN
+#define _STM8_DELAY_SHORT_MIN   18
+#endif
+#ifndef _STM8_DELAY_SHORT_SLED
+#define _STM8_DELAY_SHORT_SLED  32
+#endif
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+        MODULE  delay_cycles_short
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+        PUBLIC  _STM8_F(delay_cycles_short)
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+        ; define a CODE NOROOT section with 2^2 alignment
+        SECTION `.near_func.text`:CODE:NOROOT(2)
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;
+; extern "C" void delay_cycles_short(uint8_t wait_cycles);
+;
+; Jumps into a NOP sled, skipping (MIN+SLED-wait_cycles) NOPs, and returns
+; from its end. NOPs are single byte, single cycle instructions, so the
+; sled never stalls on fetch, wherever the jump lands.
+;
+; LD A,#n   1cy ; CALL 4cy ; NEG A 1cy ; ADD A,#  1cy ; CP A,# 1cy ; JRUGE 1cy
+; CLRW X    1cy ; LD XL,A 1cy ; ADDW X,# 2cy ; JP (X) 1cy ; RET 4cy
+; = 18 cycles plus one per NOP executed.
+
+_STM8_F(delay_cycles_short):
+        NEG     A                                               ; 1cy
+        ADD     A, #(_STM8_DELAY_SHORT_MIN+_STM8_DELAY_SHORT_SLED) ; 1cy
+        CP      A, #(_STM8_DELAY_SHORT_SLED+1)                  ; 1cy
+        JRUGE   _clamp                                          ; 1/2cy
+_jump:
+        CLRW    X                                               ; 1cy
+        LD      XL, A                                           ; 1cy
+        ADDW    X, #_sled                                       ; 2cy
+        JP      (X)                                             ; 1cy
+
+        ; out of range, not cycle exact
+_clamp:
+        CP      A, #(_STM8_DELAY_SHORT_MIN+_STM8_DELAY_SHORT_SLED+1)
+        LD      A, #_STM8_DELAY_SHORT_SLED      ; too short, no NOPs
+        JRULT   _jump
+        CLR     A                               ; too long, all NOPs
+        JRA     _jump
+
+_sled:
+        REPT    _STM8_DELAY_SHORT_SLED
+        NOP
+        ENDR
+        RET
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+        END
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
@@ -0,0 +1,143 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_DIGITAL_H
+#define __STM8HAL_DIGITAL_H
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ARDUINO STYLE DIGITAL I/O WITH RUNTIME PIN NUMBERS
+//
+// For ported code that passes pin numbers around. Include after pin.h and
+// the variant header, which provides the pin map (_STM8_PIN_MAP).
+//
+// The pin number indexes two constant tables, one with the port block
+// (offset from the GPIO base), one with the bit mask. Everything is inlined,
+// so with a constant pin number the tables fold away and a write becomes the
+// same single BSET/BRES as FastPin<>::hi()/lo().
+//
+// NOTE: With a runtime pin number, a write is a read-modify-write of ODR,
+//       which isn't atomic against interrupt handlers writing the same port.
+// NOTE: Invalid pin numbers are ignored, digitalRead() returns LOW for them.
+
+#if defined(__cplusplus)
+
+#ifndef _STM8_PIN_MAP
+#error No pin map, include the variant header before digital.h
+#endif
+
+#ifndef _STM8_GPIO_BASE
+#define _STM8_GPIO_BASE         0x5000  // PA_ODR, port blocks are 5 bytes
+#endif
+
+#ifndef LOW
+#define LOW                     0
+#define HIGH                    1
+#endif
+
+#ifndef INPUT
+#define INPUT                   0
+#define OUTPUT                  1
+#define INPUT_PULLUP            2
+#endif
+
+STM8HAL_NAMESPACE_BEGIN
+
+#define _STM8_PORT_A    0
+#define _STM8_PORT_B    5
+#define _STM8_PORT_C    10
+#define _STM8_PORT_D    15
+#define _STM8_PORT_E    20
+#define _STM8_PORT_F    25
+#define _STM8_PORT_G    30
+#define _STM8_PORT_H    35
+#define _STM8_PORT_I    40
+
+#define _STM8_PIN_PORT_ENTRY(L, BIT)    _STM8_PORT_ ## L,
+#define _STM8_PIN_MASK_ENTRY(L, BIT)    (1 << BIT),
+
+static constexpr uint8_t _stm8_pin_port[] = { _STM8_PIN_MAP(_STM8_PIN_PORT_ENTRY) };
+static constexpr uint8_t _stm8_pin_bitmask[]  = { _STM8_PIN_MAP(_STM8_PIN_MASK_ENTRY) };
+
+// The variant keeps the pin order twice, in enum STM8PortPin and in the pin
+// map; each pin's enum value must index its own port and bit.
+#define _STM8_PIN_CHECK_ENTRY(L, BIT) \
+  STATIC_ASSERT( _stm8_pin_port[ P ## L ## BIT ] == _STM8_PORT_ ## L && \
+                 _stm8_pin_bitmask[ P ## L ## BIT ] == (1 << BIT), \
+                 "pin map entry doesn't match P" #L #BIT );
+
+STATIC_ASSERT( sizeof(_stm8_pin_port) == NUM_DIGITAL_PINS, "pin map doesn't match NUM_DIGITAL_PINS" );
+_STM8_PIN_MAP(_STM8_PIN_CHECK_ENTRY)
+
+#undef _STM8_PIN_PORT_ENTRY
+#undef _STM8_PIN_MASK_ENTRY
+#undef _STM8_PIN_CHECK_ENTRY
+
+ALWAYS_INLINE
+inline volatile _STM8_GPIO * _stm8_pin_gpio(uint8_t pin)
+{
+  return (volatile _STM8_GPIO *)( _STM8_GPIO_BASE + _stm8_pin_port[pin] );
+}
+
+ALWAYS_INLINE
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+  if( pin >= NUM_DIGITAL_PINS ) return;
+  volatile _STM8_GPIO * const gpio = _stm8_pin_gpio(pin);
+  const uint8_t mask = _stm8_pin_bitmask[pin];
+
+  gpio->CR2 &= ~mask;           // slow mode, external interrupts off
+  if( mode == OUTPUT )
+  {
+    gpio->DDR |= mask;
+    gpio->CR1 |= mask;          // push-pull
+  }
+  else
+  {
+    gpio->DDR &= ~mask;
+    if( mode == INPUT_PULLUP ) gpio->CR1 |= mask; else gpio->CR1 &= ~mask;
+  }
+}
+
+ALWAYS_INLINE
+inline void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if( pin >= NUM_DIGITAL_PINS ) return;
+  volatile _STM8_GPIO * const gpio = _stm8_pin_gpio(pin);
+  if( value ) gpio->ODR |= _stm8_pin_bitmask[pin];
+  else        gpio->ODR &= ~_stm8_pin_bitmask[pin];
+}
+
+ALWAYS_INLINE
+inline uint8_t digitalRead(uint8_t pin)
+{
+  if( pin >= NUM_DIGITAL_PINS ) return LOW;
+  return ( _stm8_pin_gpio(pin)->IDR & _stm8_pin_bitmask[pin] ) ? HIGH : LOW;
+}
+
+STM8HAL_NAMESPACE_END
+
+#endif // defined(__cplusplus)
+
+#endif // __STM8HAL_DIGITAL_H
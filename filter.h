@@ -0,0 +1,250 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_FILTER_H
+#define __STM8HAL_FILTER_H
+
+#include "stm8hal.h"
+#include "math.h"
+
+#if defined(__cplusplus)
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// EXPONENTIAL MOVING AVERAGE
+//
+// y += ( x - y ) * alpha, with alpha = 1 / 2^K fixed at compile time, so the
+// multiplication turns into K right shifts. The difference is handled as an
+// unsigned magnitude plus direction, so no sign extension or wider types are
+// required.
+//
+// The time constant is about 2^K samples; after 2^K samples a step has
+// settled to ~63%, after 3 * 2^K samples to ~95%.
+//
+
+// 8-bit samples, 8-bit state.
+//
+// Cheapest version, but the output gets 'stuck' up to 2^K-1 away from a
+// constant input due to the truncated shift. Fine for K <= 2, or when the
+// input is noisy anyway.
+//
+// ~8 + K cycles per sample when inlined
+template< uint8_t K >
+struct _STM8_T(ema8)
+{
+  STATIC_ASSERT( K > 0 && K < 8, "K must be 1..7" );
+
+  uint8_t y;
+
+  _STM8_T(ema8)( uint8_t init = 0 ) : y(init) {}
+
+  ALWAYS_INLINE
+  inline uint8_t operator()( uint8_t x )
+  {
+    if( x >= y ) y += (uint8_t)( x - y ) >> K;
+    else         y -= (uint8_t)( y - x ) >> K;
+    return y;
+  }
+
+  ALWAYS_INLINE
+  inline uint8_t value() const { return y; }
+};
+
+// Up to 16-FRAC bit samples (e.g. FRAC=6 for the 10-bit ADC), 16-bit state
+// with FRAC fractional bits. With FRAC >= K the output converges to the
+// exact input value.
+//
+// ~14 + K cycles per sample when inlined; byte sized shifts (K=8) are free
+template< uint8_t K, uint8_t FRAC = 8 >
+struct _STM8_T(ema16)
+{
+  STATIC_ASSERT( K > 0 && K < 16, "K must be 1..15" );
+  STATIC_ASSERT( FRAC < 16, "FRAC must be 0..15" );
+
+  uint16_t y;
+
+  _STM8_T(ema16)( uint16_t init = 0 ) : y( (uint16_t)( init << FRAC ) ) {}
+
+  ALWAYS_INLINE
+  inline uint16_t operator()( uint16_t x )
+  {
+    register uint16_t t = (uint16_t)( x << FRAC );
+    if( t >= y ) y += (uint16_t)( t - y ) >> K;
+    else         y -= (uint16_t)( y - t ) >> K;
+    return value();
+  }
+
+  // rounded to the input resolution
+  ALWAYS_INLINE
+  inline uint16_t value() const
+  {
+    if( FRAC == 0 ) return y;
+    return (uint16_t)( y + ( ( 1u << FRAC ) >> 1 ) ) >> FRAC;
+  }
+
+  // full resolution state, FRAC fractional bits
+  ALWAYS_INLINE
+  inline uint16_t raw() const { return y; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// BIQUAD IIR, Q1.15
+//
+// Direct Form I, one second order section:
+//
+//   y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] + a1*y[n-1] + a2*y[n-2]
+//
+// NOTE: a1 and a2 are the NEGATED feedback coefficients of the usual
+//       transfer function, i.e. pass -a1, -a2 as in CMSIS-DSP.
+//
+// All coefficients are Q1.15 and must be pre-scaled by 2^-POST_SHIFT, so
+// that coefficients in the range [-2^POST_SHIFT .. 2^POST_SHIFT) can be
+// represented; |a1| is often close to 2 for low cutoff frequencies, hence
+// the default of 1. The products are accumulated with 32 bits and the
+// result is saturated to Q1.15.
+//
+// Each product is a _STM8_F(mul16s), i.e. four 8x8 MUL instructions.
+// Estimated ~380 cycles per sample, 5 multiplications and 32-bit sums.
+//
+template< uint8_t POST_SHIFT = 1 >
+struct _STM8_T(biquad)
+{
+  STATIC_ASSERT( POST_SHIFT < 15, "POST_SHIFT must be 0..14" );
+
+  int16_t b0, b1, b2, a1, a2;   // coefficients, Q1.15 >> POST_SHIFT
+  int16_t x1, x2, y1, y2;       // state, Q1.15
+
+  _STM8_T(biquad)( int16_t _b0, int16_t _b1, int16_t _b2,
+                   int16_t _a1, int16_t _a2 )
+    : b0(_b0), b1(_b1), b2(_b2), a1(_a1), a2(_a2), x1(0), x2(0), y1(0), y2(0) {}
+
+  OPTIMIZE_SPEED
+  int16_t operator()( int16_t x )
+  {
+    int32_t acc = 1L << ( 14 - POST_SHIFT );  // round
+    acc += _STM8_F(mul16s)( b0, x  );
+    acc += _STM8_F(mul16s)( b1, x1 );
+    acc += _STM8_F(mul16s)( b2, x2 );
+    acc += _STM8_F(mul16s)( a1, y1 );
+    acc += _STM8_F(mul16s)( a2, y2 );
+
+    acc >>= 15 - POST_SHIFT;
+    register int16_t y;
+    if( acc >  0x7FFF )     y =  0x7FFF;  // saturate
+    else if( acc < -0x8000L ) y = -0x8000;
+    else                    y = (int16_t)acc;
+
+    x2 = x1; x1 = x;
+    y2 = y1; y1 = y;
+    return y;
+  }
+
+  void reset() { x1 = x2 = y1 = y2 = 0; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// MEDIAN FILTER, FIXED WINDOW OF 3, 5 OR 7 SAMPLES
+//
+// The median is selected with a sorting network, pruned to the comparators
+// that actually contribute to the middle element. There are no data
+// dependent loops, so every sample takes the same time.
+//
+//   N=3:  3 compare/exchange,  ~30 cycles per 8-bit sample
+//   N=5:  8 compare/exchange,  ~80 cycles per 8-bit sample
+//   N=7: 14 compare/exchange, ~140 cycles per 8-bit sample
+//
+// (estimates, including the copy of the window; roughly double for 16-bit)
+
+template< typename T >
+ALWAYS_INLINE
+inline void _STM8_F(cswap)( T & a, T & b )
+{
+  if( b < a ) { register T t = a; a = b; b = t; }
+}
+
+template< typename T >
+ALWAYS_INLINE
+inline T _STM8_F(median3)( T a, T b, T c )
+{
+  _STM8_F(cswap)(a,b); _STM8_F(cswap)(b,c); _STM8_F(cswap)(a,b);
+  return b;
+}
+
+template< typename T >
+OPTIMIZE_SPEED
+inline T _STM8_F(median5)( T * v )
+{
+  _STM8_F(cswap)(v[3],v[4]); _STM8_F(cswap)(v[2],v[4]);
+  _STM8_F(cswap)(v[2],v[3]); _STM8_F(cswap)(v[0],v[3]);
+  _STM8_F(cswap)(v[0],v[2]); _STM8_F(cswap)(v[1],v[4]);
+  _STM8_F(cswap)(v[1],v[3]); _STM8_F(cswap)(v[1],v[2]);
+  return v[2];
+}
+
+template< typename T >
+OPTIMIZE_SPEED
+inline T _STM8_F(median7)( T * v )
+{
+  _STM8_F(cswap)(v[0],v[6]); _STM8_F(cswap)(v[2],v[3]);
+  _STM8_F(cswap)(v[4],v[5]); _STM8_F(cswap)(v[0],v[2]);
+  _STM8_F(cswap)(v[1],v[4]); _STM8_F(cswap)(v[3],v[6]);
+  _STM8_F(cswap)(v[0],v[1]); _STM8_F(cswap)(v[2],v[5]);
+  _STM8_F(cswap)(v[3],v[4]); _STM8_F(cswap)(v[1],v[2]);
+  _STM8_F(cswap)(v[4],v[6]); _STM8_F(cswap)(v[2],v[3]);
+  _STM8_F(cswap)(v[4],v[5]); _STM8_F(cswap)(v[3],v[4]);
+  return v[3];
+}
+
+// Sliding window median over the last N samples. The window starts out
+// filled with the initial value.
+template< uint8_t N, typename T = uint8_t >
+struct _STM8_T(median)
+{
+  STATIC_ASSERT( N == 3 || N == 5 || N == 7, "N must be 3, 5 or 7" );
+
+  T w[N];
+  uint8_t i;
+
+  _STM8_T(median)( T init = 0 ) : i(0)
+  { for( uint8_t j=0; j<N; ++j) w[j] = init; }
+
+  OPTIMIZE_SPEED
+  T operator()( T x )
+  {
+    w[i] = x;
+    if( ++i == N ) i = 0;
+
+    if( N == 3 ) return _STM8_F(median3)( w[0], w[1], w[2] );
+
+    T t[N];                             // the networks sort in place
+    for( uint8_t j=0; j<N; ++j) t[j] = w[j];
+    return N == 5 ? _STM8_F(median5)( t ) : _STM8_F(median7)( t );
+  }
+};
+
+#endif // defined(__cplusplus)
+
+#endif // __STM8HAL_FILTER_H
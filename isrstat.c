@@ -0,0 +1,100 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "isrstat.h"
+
+#ifdef _STM8_ISR_STATS
+
+#include <stdio.h>
+
+_STM8_T(isr_stat) _stm8_isr_table[ _STM8_ISR_VECTORS ];
+
+_EXTERN_C
+
+OPTIMIZE_SPEED
+NO_INTERRUPTS   // interrupts are disabled during execution
+void _STM8_F(isr_record)(uint8_t vector, uint16_t start)
+{
+  const uint16_t cycles = _STM8_F(cycles16)() - start;
+  if( vector >= _STM8_ISR_VECTORS ) return;
+
+  _STM8_T(isr_stat) * s = &_stm8_isr_table[ vector ];
+  if( s->count == 0xFFFF ) return;
+  ++s->count;
+  s->sum += cycles;
+  if( cycles > s->max ) s->max = cycles;
+}
+
+OPTIMIZE_SPEED
+NO_INTERRUPTS   // interrupts are disabled during execution
+void _STM8_F(isr_latency)(uint8_t vector, uint16_t cycles)
+{
+  if( vector >= _STM8_ISR_VECTORS ) return;
+  if( cycles > _stm8_isr_table[ vector ].latency )
+    _stm8_isr_table[ vector ].latency = cycles;
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS   // interrupts are disabled during execution
+void _STM8_F(isr_reset)(void)
+{
+  for( uint8_t i=0; i<_STM8_ISR_VECTORS; ++i)
+  {
+    _stm8_isr_table[i].count = 0;
+    _stm8_isr_table[i].max = 0;
+    _stm8_isr_table[i].sum = 0;
+    _stm8_isr_table[i].latency = 0;
+  }
+#if defined(_STM8_ISR_DEBUG_PIN) && defined(__cplusplus)
+  FastPin< _STM8_ISR_DEBUG_PIN >::setOutput(PushPull_Fast);
+  FastPin< _STM8_ISR_DEBUG_PIN >::lo();
+#endif
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS   // interrupts are disabled during execution
+static void _stm8_isr_copy(_STM8_T(isr_stat) * s, uint8_t vector)
+{
+  *s = _stm8_isr_table[ vector ];
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(isr_report)(void)
+{
+  for( uint8_t i=0; i<_STM8_ISR_VECTORS; ++i)
+  {
+    _STM8_T(isr_stat) s;
+    _stm8_isr_copy( &s, i );
+    if( !s.count ) continue;
+    printf( "vector %u: n=%u mean=%lu max=%u latency=%u\n",
+            i, s.count, (unsigned long)( s.sum / s.count ), s.max, s.latency );
+  }
+}
+
+_END_EXTERN_C
+
+#endif // _STM8_ISR_STATS
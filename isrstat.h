@@ -0,0 +1,128 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_ISRSTAT_H
+#define __STM8HAL_ISRSTAT_H
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// INTERRUPT HANDLER STATISTICS
+//
+// Interrupt handlers mark their start and end with ISR_ENTER(vector) and
+// ISR_EXIT(vector); both compile to nothing unless _STM8_ISR_STATS is
+// defined. With it, every handler records its invocation count, total and
+// max duration in cycles (debug.h cycle counter), and, where the handler
+// can tell how late it started, its max entry latency (ISR_LATENCY).
+// isr_report() prints the table with printf().
+//
+// With _STM8_TRACE, ISR_ENTER/EXIT also emit TRACE_ISR_ENTER/EXIT events.
+// With _STM8_STACK_ISR, ISR_ENTER samples the stack depth (stack.h), also
+// without _STM8_ISR_STATS.
+// With _STM8_ISR_DEBUG_PIN (C++ only), that pin is high while any
+// instrumented handler runs, as a marker for a scope or logic analyzer.
+//
+// NOTE: The duration includes the time spent in nested handlers, and
+//       excludes the compiler's entry and exit code (~10-30 cycles,
+//       depending on the registers saved).
+// NOTE: Needs the cycle counter started with enableCycleCounter(), and
+//       10 bytes of RAM per vector.
+
+#ifndef _STM8_ISR_VECTORS
+#define _STM8_ISR_VECTORS       32      // vectors 0..31, i.e. IRQ 0..29
+#endif
+
+#ifdef _STM8_STACK_ISR
+#include "stack.h"
+# define _STM8_ISR_STACK(vector) _STM8_F(stack_sample)(vector)
+#else
+# define _STM8_ISR_STACK(vector) do {} while(0)
+#endif
+
+#ifdef _STM8_ISR_STATS
+
+#include "debug.h"
+#include "trace.h"
+#if defined(_STM8_ISR_DEBUG_PIN) && defined(__cplusplus)
+#include "pin.h"
+#endif
+
+_EXTERN_C
+
+typedef struct
+{
+  uint16_t count;       // saturates at 65535, then sum stops as well
+  uint16_t max;
+  uint32_t sum;
+  uint16_t latency;     // max, 0 if not recorded
+}
+_STM8_T(isr_stat);
+
+extern _STM8_T(isr_stat) _stm8_isr_table[ _STM8_ISR_VECTORS ];
+
+// Add a handler run that started at the given cycles16().
+void _STM8_F(isr_record)(uint8_t vector, uint16_t start);
+
+// Record an entry latency in cycles.
+void _STM8_F(isr_latency)(uint8_t vector, uint16_t cycles);
+
+// Clear all statistics and set up the debug pin.
+void _STM8_F(isr_reset)(void);
+
+// Print count, mean and max duration and max latency per used vector.
+void _STM8_F(isr_report)(void);
+
+_END_EXTERN_C
+
+#if defined(_STM8_ISR_DEBUG_PIN) && defined(__cplusplus)
+# define _STM8_ISR_PIN_HI()     FastPin< _STM8_ISR_DEBUG_PIN >::hi()
+# define _STM8_ISR_PIN_LO()     FastPin< _STM8_ISR_DEBUG_PIN >::lo()
+#else
+# define _STM8_ISR_PIN_HI()     do {} while(0)
+# define _STM8_ISR_PIN_LO()     do {} while(0)
+#endif
+
+#define ISR_ENTER(vector) \
+  const uint16_t _stm8_isr_start = _STM8_F(cycles16)(); \
+  _STM8_ISR_PIN_HI(); \
+  _STM8_ISR_STACK(vector); \
+  TRACE_ISR_ENTER(vector)
+
+#define ISR_EXIT(vector) \
+  do { \
+    TRACE_ISR_EXIT(vector); \
+    _STM8_F(isr_record)( (vector), _stm8_isr_start ); \
+    _STM8_ISR_PIN_LO(); \
+  } while(0)
+
+#define ISR_LATENCY(vector, cycles) _STM8_F(isr_latency)( (vector), (cycles) )
+
+#else
+
+#define ISR_ENTER(vector)           _STM8_ISR_STACK(vector)
+#define ISR_EXIT(vector)            do {} while(0)
+#define ISR_LATENCY(vector, cycles) do {} while(0)
+
+#endif // _STM8_ISR_STATS
+
+#endif // __STM8HAL_ISRSTAT_H
@@ -0,0 +1,245 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "timer.h"
+#include "kernel.h"
+#include "load.h"
+
+#if _STM8_KERNEL_TASKS > 8
+#error _STM8_KERNEL_TASKS must not exceed 8
+#endif
+
+#if defined(__ICCSTM8__)
+# define _STM8_KERNEL_TRAP_VECTOR TRAP_vector
+# define _STM8_KERNEL_SPR         ITC_SPR6     // VECT23SPR, bits 7:6
+#else
+# define _STM8_KERNEL_TRAP_VECTOR _Pragma("error Unsupported compiler")
+# define _STM8_KERNEL_SPR         ITC->ISPR6
+#endif
+
+#define _STM8_TASK_FREE         0
+#define _STM8_TASK_READY        1
+#define _STM8_TASK_SLEEPING     2
+#define _STM8_TASK_BLOCKED      3
+
+////////////////////////////////////////////////////////////////////////////////
+
+_STM8_T(tcb) _stm8_kernel_tcb[ _STM8_KERNEL_TASKS ];
+
+// the running task, used by kernel_switch.asm
+_STM8_T(tcb) * _stm8_kernel_current = 0;
+
+static TINY uint8_t _stm8_kernel_id = 0;
+static TINY bool    _stm8_kernel_running = false;
+
+_EXTERN_C
+
+// the first instruction of a new task, see kernel_switch.asm
+extern void _STM8_F(kernel_iret)(void);
+
+// a task function that returns ends up here
+OPTIMIZE_SIZE
+static void _stm8_kernel_exit(void)
+{
+  disableInterrupts();
+  _stm8_kernel_tcb[ _stm8_kernel_id ].state = _STM8_TASK_FREE;
+  trap();                               // never returns
+  for(;;);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// The initial stack of a new task, as popped by kernel_switch (registers, a
+// return address into kernel_iret) and by IRET (the interrupt frame), and
+// finally the return address of the task function itself.
+//
+OPTIMIZE_SIZE
+NO_INTERRUPTS   // interrupts are disabled during execution
+uint8_t _STM8_F(kernel_task)(_STM8_T(task_fn) fn, void * arg, uint8_t prio,
+                             uint8_t * stack, uint16_t size)
+{
+  uint8_t id = 1;                       // 0 is main/idle
+  while( id < _STM8_KERNEL_TASKS
+      && _stm8_kernel_tcb[id].state != _STM8_TASK_FREE ) ++id;
+  if( id == _STM8_KERNEL_TASKS ) return 0xFF;
+
+  // STM8 PUSH: store at SP, then decrement
+  uint8_t * sp = stack + size - 1;
+  #define _PUSH(b)  *sp-- = (uint8_t)(b)
+  #define _PUSHW(w) do { _PUSH( (uint16_t)(w) ); _PUSH( (uint16_t)(w) >> 8 ); } while(0)
+
+  _PUSHW( _stm8_kernel_exit );          // RET of the task function
+
+  _PUSHW( fn ); _PUSH( 0 );             // interrupt frame: PCL, PCH, PCE
+  _PUSHW( 0 );                          // Y
+  _PUSHW( arg );                        // X, i.e. the first parameter
+  _PUSH( 0 );                           // A
+  _PUSH( 0x20 );                        // CC: I1:I0 = 10, main level
+
+  _PUSHW( _STM8_F(kernel_iret) );       // RET of kernel_switch
+
+  _PUSH( 0x28 );                        // CC, interrupts masked until IRET
+  _PUSH( 0 );                           // A
+  _PUSHW( 0 );                          // X
+  _PUSHW( 0 );                          // Y
+  for( uint8_t i=0; i<16; ++i) _PUSH( 0 );    // ?b0..?b15
+
+  #undef _PUSHW
+  #undef _PUSH
+
+  _stm8_kernel_tcb[id].sp = (uint16_t)sp;
+  _stm8_kernel_tcb[id].prio = prio;
+  _stm8_kernel_tcb[id].state = _STM8_TASK_READY;
+  return id;
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(kernel_start)(void)
+{
+  disableInterrupts();
+
+  // TIM4/TIM6 (IRQ 23) at the lowest software priority, level 1 (01)
+  _STM8_KERNEL_SPR = ( _STM8_KERNEL_SPR & ~0xC0 ) | 0x40;
+
+  _stm8_kernel_tcb[0].prio = 0;
+  _stm8_kernel_tcb[0].state = _STM8_TASK_READY;
+  _stm8_kernel_id = 0;
+  _stm8_kernel_current = &_stm8_kernel_tcb[0];
+  _stm8_kernel_running = true;
+
+  enableInterrupts();
+  trap();                               // run the highest priority task
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SCHEDULER, called by kernel_switch with interrupts masked
+//
+// The highest priority ready task; with equal priority, the one after the
+// current task in the table (round robin). main/idle is always ready.
+//
+OPTIMIZE_SPEED
+_STM8_T(tcb) * _STM8_F(kernel_next)(void)
+{
+  uint8_t best = 0;
+  uint8_t id = _stm8_kernel_id;
+  for( uint8_t n=0; n<_STM8_KERNEL_TASKS; ++n)
+  {
+    if( ++id == _STM8_KERNEL_TASKS ) id = 0;
+    if( _stm8_kernel_tcb[id].state == _STM8_TASK_READY
+     && _stm8_kernel_tcb[id].prio > _stm8_kernel_tcb[best].prio ) best = id;
+  }
+  _stm8_kernel_id = best;
+  (void)LOAD_TASK(best);
+  return &_stm8_kernel_tcb[best];
+}
+
+OPTIMIZE_SPEED
+bool _STM8_F(kernel_tick)(void)
+{
+  if( !_stm8_kernel_running ) return false;
+
+  const uint16_t now = _STM8_F(millis16)();
+  const uint8_t prio = _stm8_kernel_tcb[ _stm8_kernel_id ].prio;
+  bool due = false;
+
+  for( uint8_t id=0; id<_STM8_KERNEL_TASKS; ++id)
+  {
+    _STM8_T(tcb) * t = &_stm8_kernel_tcb[id];
+    if( t->state == _STM8_TASK_SLEEPING && (int16_t)( now - t->wake ) >= 0 )
+      t->state = _STM8_TASK_READY;
+    if( id != _stm8_kernel_id && t->state == _STM8_TASK_READY && t->prio >= prio )
+      due = true;
+  }
+  return due;
+}
+
+// The TRAP handler does a voluntary switch; it's only ever used from tasks.
+OPTIMIZE_SPEED
+INTERRUPT( _STM8_KERNEL_TRAP_VECTOR )
+void _stm8_kernel_trap(void)
+{
+  _STM8_F(kernel_switch)();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+OPTIMIZE_SIZE
+void _STM8_F(kernel_yield)(void)
+{
+  trap();
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS   // interrupts are disabled during execution
+static void _stm8_kernel_suspend(uint16_t ms)
+{
+  _STM8_T(tcb) * t = &_stm8_kernel_tcb[ _stm8_kernel_id ];
+  t->wake = _STM8_F(millis16)() + ms;
+  if( _stm8_kernel_id ) t->state = _STM8_TASK_SLEEPING;   // idle never sleeps
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(kernel_sleep)(uint16_t ms)
+{
+  _stm8_kernel_suspend(ms);
+  trap();
+}
+
+OPTIMIZE_SIZE
+uint8_t _STM8_F(kernel_self)(void)
+{
+  return _stm8_kernel_id;
+}
+
+// with interrupts disabled (Semaphore)
+OPTIMIZE_SIZE
+void _STM8_F(kernel_block)(uint8_t * waiting)
+{
+  if( !_stm8_kernel_id ) return;        // idle must not block, it spins
+  *waiting |= 1 << _stm8_kernel_id;
+  _stm8_kernel_tcb[ _stm8_kernel_id ].state = _STM8_TASK_BLOCKED;
+}
+
+// with interrupts disabled (Semaphore); wakes the highest priority waiter
+OPTIMIZE_SIZE
+bool _STM8_F(kernel_wake)(uint8_t * waiting)
+{
+  if( !*waiting ) return false;
+  uint8_t best = 0xFF;
+  for( uint8_t id=1; id<_STM8_KERNEL_TASKS; ++id)
+  {
+    if( ( *waiting & ( 1 << id ) )
+     && ( best == 0xFF || _stm8_kernel_tcb[id].prio > _stm8_kernel_tcb[best].prio ) )
+      best = id;
+  }
+  *waiting &= ~( 1 << best );
+  _stm8_kernel_tcb[best].state = _STM8_TASK_READY;
+  return true;
+}
+
+_END_EXTERN_C
@@ -0,0 +1,176 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_KERNEL_H
+#define __STM8HAL_KERNEL_H
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// MINIMAL PREEMPTIVE KERNEL
+//
+// Intended for the larger parts (e.g. STM8S105K4/K6 with 2KB RAM), as every
+// task needs its own stack of at least ~64 bytes.
+//
+//  - fixed priorities 1.._STM8_KERNEL_PRIOS-1 (higher runs first); tasks of
+//    the same priority are time sliced round robin every millisecond
+//  - main() becomes the idle task (priority 0) when the kernel is started
+//  - preemption from the TIM4/TIM6 update interrupt; define _STM8_KERNEL
+//    when compiling timer.c to hook it in
+//  - tasks block and yield through TRAP, so these calls are only allowed
+//    from tasks, never from interrupt handlers
+//  - counting semaphores, based on the Mutex class (compat.h)
+//
+// The timer interrupt is set to the lowest software priority (level 1), so
+// it never preempts another interrupt handler, and a switch only ever
+// happens between tasks. Other interrupts keep their priorities and may
+// still preempt the switch itself; they run on the current task's stack.
+//
+// CONTEXT SWITCH COST (from the instruction timings, not measured)
+//
+//  save / restore (kernel_switch.asm)      ~55 cycles
+//  scheduler, 4 tasks                     ~60 cycles
+//  TRAP or interrupt entry + IRET          ~20 cycles
+//                                        ---------
+//                                        ~135 cycles, ~8.5us at 16MHz
+//
+// A switch from the timer interrupt adds the time keeping of the ISR.
+//
+// NOTE: Task stacks must lie within the device's stack area (see the stack
+//       roll-over address in the datasheet), e.g. by carving them out of
+//       CSTACK in the linker configuration.
+// NOTE: The switch saves the IAR virtual registers ?b0..?b15, i.e. the
+//       default of 16 virtual registers is assumed.
+
+#ifndef _STM8_KERNEL_TASKS
+#define _STM8_KERNEL_TASKS      4       // including main/idle, max 8
+#endif
+
+#ifndef _STM8_KERNEL_PRIOS
+#define _STM8_KERNEL_PRIOS      4
+#endif
+
+_EXTERN_C
+
+typedef void (*_STM8_T(task_fn))(void * arg);
+
+typedef struct
+{
+  uint16_t sp;          // saved stack pointer, MUST be first (see asm)
+  uint16_t wake;        // millis16() to wake up at when sleeping
+  uint8_t  prio;
+  uint8_t  state;
+}
+_STM8_T(tcb);
+
+// Create a task; stack is the lowest address of its stack area.
+// Returns the task id, or 0xFF if there are no free slots.
+// Can be called before and after starting the kernel.
+uint8_t _STM8_F(kernel_task)(_STM8_T(task_fn) fn, void * arg, uint8_t prio,
+                             uint8_t * stack, uint16_t size);
+
+// Turn main() into the idle task and start scheduling.
+// The timer must already be enabled.
+void _STM8_F(kernel_start)(void);
+
+// Give up the CPU to other tasks of the same or higher priority.
+void _STM8_F(kernel_yield)(void);
+
+// Block the calling task for the given number of milliseconds.
+void _STM8_F(kernel_sleep)(uint16_t ms);
+
+// Called from the timer interrupt; returns true if a switch is due.
+bool _STM8_F(kernel_tick)(void);
+
+// Saves the current context, calls the scheduler and restores the context
+// of the next task; see kernel_switch.asm. Interrupt context only!
+void _STM8_F(kernel_switch)(void);
+
+// id of the running task, 0 = main/idle
+uint8_t _STM8_F(kernel_self)(void);
+
+// internal: block the current task on a semaphore / wake one waiter
+void _STM8_F(kernel_block)(uint8_t * waiting);
+bool _STM8_F(kernel_wake)(uint8_t * waiting);
+
+_END_EXTERN_C
+
+#ifdef __cplusplus
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Counting semaphore. take() blocks the calling task; give() may be used from
+// tasks or interrupt handlers (giveFromISR). When given from an interrupt,
+// a waiting task of higher priority only runs at the next tick.
+
+class Semaphore
+{
+  volatile uint8_t mCount;
+  uint8_t mWaiting;             // one bit per blocked task
+
+public:
+  Semaphore(uint8_t count = 0) : mCount(count), mWaiting(0) {}
+
+  void take()
+  {
+    for(;;)
+    {
+      {
+        Mutex m;
+        if( mCount ) { --mCount; return; }
+        _STM8_F(kernel_block)(&mWaiting);
+      }
+      trap();                   // switch, retry when woken
+    }
+  }
+
+  bool tryTake()
+  {
+    Mutex m;
+    if( !mCount ) return false;
+    --mCount;
+    return true;
+  }
+
+  void give()
+  {
+    bool woken;
+    {
+      Mutex m;
+      ++mCount;
+      woken = _STM8_F(kernel_wake)(&mWaiting);
+    }
+    if( woken ) trap();         // let the scheduler decide
+  }
+
+  void giveFromISR()
+  {
+    Mutex m;
+    ++mCount;
+    _STM8_F(kernel_wake)(&mWaiting);
+  }
+};
+
+#endif // __cplusplus
+
+#endif // __STM8HAL_KERNEL_H
@@ -0,0 +1,100 @@
+#include "vregs.inc"
+
+#define _STM8HAL_INTERNAL
+#include "stm8hal.h"
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+        MODULE  kernel_switch
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+        PUBLIC  _STM8_F(kernel_switch)
+        PUBLIC  _STM8_F(kernel_iret)
+
+        EXTERN  _STM8_F(kernel_next)
+        EXTERN  _stm8_kernel_current
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+        ; define a CODE NOROOT section with 2^2 alignment
+        SECTION `.near_func.text`:CODE:NOROOT(2)
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;
+; extern "C" void kernel_switch();
+;
+; Only called from the TRAP and timer interrupt handlers. Saves the registers
+; and virtual registers on the current stack, stores SP in the TCB (sp is its
+; first member), asks the scheduler for the next TCB and restores its context.
+; The stack layout must match the one fabricated in kernel_task().
+
+_STM8_F(kernel_switch):
+        PUSH    CC              ; 1cy
+        SIM                     ; 1cy
+        PUSH    A               ; 1cy
+        PUSHW   X               ; 2cy
+        PUSHW   Y               ; 2cy
+        PUSH    ?b0             ; 16 x 1cy
+        PUSH    ?b1
+        PUSH    ?b2
+        PUSH    ?b3
+        PUSH    ?b4
+        PUSH    ?b5
+        PUSH    ?b6
+        PUSH    ?b7
+        PUSH    ?b8
+        PUSH    ?b9
+        PUSH    ?b10
+        PUSH    ?b11
+        PUSH    ?b12
+        PUSH    ?b13
+        PUSH    ?b14
+        PUSH    ?b15
+
+        LDW     X, SP           ; 1cy
+        LDW     Y, _stm8_kernel_current
+        LDW     (Y), X          ; 2cy   tcb->sp = SP
+
+        CALL    _STM8_F(kernel_next)    ; returns the next TCB in X
+
+        LDW     _stm8_kernel_current, X
+        LDW     X, (X)          ; 2cy
+        LDW     SP, X           ; 1cy
+
+        POP     ?b15            ; 16 x 1cy
+        POP     ?b14
+        POP     ?b13
+        POP     ?b12
+        POP     ?b11
+        POP     ?b10
+        POP     ?b9
+        POP     ?b8
+        POP     ?b7
+        POP     ?b6
+        POP     ?b5
+        POP     ?b4
+        POP     ?b3
+        POP     ?b2
+        POP     ?b1
+        POP     ?b0
+        POPW    Y               ; 2cy
+        POPW    X               ; 2cy
+        POP     A               ; 1cy
+        POP     CC              ; 1cy
+        RET                     ; 4cy
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;
+; The first return of kernel_switch into a new task lands here; the interrupt
+; frame below enters the task function at main level.
+
+_STM8_F(kernel_iret):
+        IRET
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+        END
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
@@ -0,0 +1,162 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "load.h"
+
+#if 1000 % _STM8_LOAD_WINDOW
+#error _STM8_LOAD_WINDOW must divide 1000
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// All spans are folded into the 32-bit sums at least once per tick, so the
+// 16-bit cycle differences can't wrap (below 65MHz).
+
+static uint32_t _stm8_load_idle_cycles = 0;     // this window
+static uint32_t _stm8_load_idle_last = _STM8_LOAD_CYCLES;
+static uint32_t _stm8_load_idle_min = _STM8_LOAD_CYCLES;   // this second
+static uint32_t _stm8_load_idle_peak = _STM8_LOAD_CYCLES;  // last second
+static uint16_t _stm8_load_idle_start;
+static TINY bool _stm8_load_idling = false;
+
+static TINY uint16_t _stm8_load_ms = 0;       // up to 1000
+static TINY uint16_t _stm8_load_windows = 0;  // up to 1000
+
+static uint32_t _stm8_load_task_cycles[ _STM8_LOAD_TASKS ];
+static uint32_t _stm8_load_task_last[ _STM8_LOAD_TASKS ];
+static uint16_t _stm8_load_task_start;
+static TINY uint8_t _stm8_load_task_id = _STM8_LOAD_NONE;
+
+_EXTERN_C
+
+OPTIMIZE_SPEED
+void _STM8_F(load_wfi)(void)
+{
+  _stm8_load_idle_start = _STM8_F(cycles16)();
+  _stm8_load_idling = true;
+  wfi();                                // enables interrupts, halts until one
+
+  // unless the timer interrupt woke us, fold the idle span here
+  disableInterrupts();
+  if( _stm8_load_idling )
+  {
+    _stm8_load_idle_cycles += (uint16_t)( _STM8_F(cycles16)() - _stm8_load_idle_start );
+    _stm8_load_idling = false;
+  }
+  enableInterrupts();
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(load_idle)(void)
+{
+  disableInterrupts();
+  _STM8_F(load_wfi)();
+}
+
+OPTIMIZE_SPEED
+void _STM8_F(load_tick)(void)
+{
+  const uint16_t now = _STM8_F(cycles16)();
+
+  if( _stm8_load_idling )
+  {
+    _stm8_load_idle_cycles += (uint16_t)( now - _stm8_load_idle_start );
+    _stm8_load_idling = false;
+  }
+  if( _stm8_load_task_id < _STM8_LOAD_TASKS )
+    _stm8_load_task_cycles[ _stm8_load_task_id ] += (uint16_t)( now - _stm8_load_task_start );
+  _stm8_load_task_start = now;
+
+  if( ++_stm8_load_ms < _STM8_LOAD_WINDOW ) return;
+  _stm8_load_ms = 0;
+
+  // close the window
+  _stm8_load_idle_last = _stm8_load_idle_cycles;
+  _stm8_load_idle_cycles = 0;
+  if( _stm8_load_idle_last < _stm8_load_idle_min )
+    _stm8_load_idle_min = _stm8_load_idle_last;
+
+  for( uint8_t i=0; i<_STM8_LOAD_TASKS; ++i)
+  {
+    _stm8_load_task_last[i] = _stm8_load_task_cycles[i];
+    _stm8_load_task_cycles[i] = 0;
+  }
+
+  if( ++_stm8_load_windows < 1000 / _STM8_LOAD_WINDOW ) return;
+  _stm8_load_windows = 0;
+  _stm8_load_idle_peak = _stm8_load_idle_min;
+  _stm8_load_idle_min = _STM8_LOAD_CYCLES;
+}
+
+OPTIMIZE_SPEED
+NO_INTERRUPTS   // interrupts are disabled during execution
+uint8_t _STM8_F(load_task)(uint8_t id)
+{
+  const uint16_t now = _STM8_F(cycles16)();
+  const uint8_t prev = _stm8_load_task_id;
+  if( prev < _STM8_LOAD_TASKS )
+    _stm8_load_task_cycles[ prev ] += (uint16_t)( now - _stm8_load_task_start );
+  _stm8_load_task_start = now;
+  _stm8_load_task_id = id;
+  return prev;
+}
+
+// cycles of a window in percent
+OPTIMIZE_SIZE
+static uint8_t _stm8_load_share(uint32_t cycles)
+{
+  if( cycles >= _STM8_LOAD_CYCLES ) return 100;
+  return (uint8_t)( ( cycles * 100 ) / _STM8_LOAD_CYCLES );
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS   // interrupts are disabled during execution
+static uint32_t _stm8_load_read(const uint32_t * value)
+{
+  return *value;
+}
+
+OPTIMIZE_SIZE
+uint8_t _STM8_F(load_percent)(void)
+{
+  return 100 - _stm8_load_share( _stm8_load_read( &_stm8_load_idle_last ) );
+}
+
+OPTIMIZE_SIZE
+uint8_t _STM8_F(load_peak)(void)
+{
+  return 100 - _stm8_load_share( _stm8_load_read( &_stm8_load_idle_peak ) );
+}
+
+OPTIMIZE_SIZE
+uint8_t _STM8_F(load_task_percent)(uint8_t id)
+{
+  if( id >= _STM8_LOAD_TASKS ) return 0;
+  return _stm8_load_share( _stm8_load_read( &_stm8_load_task_last[id] ) );
+}
+
+_END_EXTERN_C
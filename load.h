@@ -0,0 +1,95 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_LOAD_H
+#define __STM8HAL_LOAD_H
+
+#include "debug.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CPU LOAD METER
+//
+// Counts the cycles (debug.h cycle counter) spent idle in WFI per window of
+// _STM8_LOAD_WINDOW timer ticks; the load is what's left of the window's
+// F_CPU cycles. Define _STM8_LOAD for the whole build (e.g. in the
+// STM8HAL_CONF file), start the cycle counter with enableCycleCounter(),
+// and let the idle loop sleep with load_idle(). The WFI delays (delay.c,
+// _STM8_DELAY_WFI) are accounted automatically.
+//
+// With the protothread scheduler (pt.c) or the kernel (kernel.c), the cycles
+// each task runs are counted as well, see load_task_percent().
+//
+// NOTE: Idle ends when the timer interrupt starts. Other interrupts that
+//       wake the core from WFI are counted as idle time.
+
+#ifndef _STM8_LOAD_WINDOW
+#define _STM8_LOAD_WINDOW       100     // ms, a divider of 1000
+#endif
+
+#ifndef _STM8_LOAD_TASKS
+#define _STM8_LOAD_TASKS        8
+#endif
+
+#define _STM8_LOAD_NONE         0xFF    // not in any task
+
+// F_CPU cycles per window
+#define _STM8_LOAD_CYCLES       ( (uint32_t)_STM8_LOAD_WINDOW * ( (F_CPU) / 1000UL ) )
+
+_EXTERN_C
+
+// Halt until the next interrupt, counted as idle time.
+void _STM8_F(load_idle)(void);
+
+// As load_idle(), with interrupts already disabled, returns with interrupts
+// enabled, just like wfi().
+void _STM8_F(load_wfi)(void);
+
+// Called first thing in the timer interrupt.
+void _STM8_F(load_tick)(void);
+
+// Called by schedulers when switching to task id, or _STM8_LOAD_NONE.
+// Returns the previous task.
+uint8_t _STM8_F(load_task)(uint8_t id);
+
+// Load of the last window in percent.
+uint8_t _STM8_F(load_percent)(void);
+
+// Highest load of a window in the last full second, in percent.
+uint8_t _STM8_F(load_peak)(void);
+
+// Share of the last window the task ran, in percent.
+uint8_t _STM8_F(load_task_percent)(uint8_t id);
+
+_END_EXTERN_C
+
+#ifdef _STM8_LOAD
+#define LOAD_WFI()      _STM8_F(load_wfi)()
+#define LOAD_TASK(id)   _STM8_F(load_task)(id)
+#else
+#define LOAD_WFI()      wfi()
+#define LOAD_TASK(id)   ( (void)(id), (uint8_t)_STM8_LOAD_NONE )
+#endif
+
+#endif // __STM8HAL_LOAD_H
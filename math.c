@@ -24,6 +24,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define _STM8HAL_INTERNAL
 #include "stm8hal.h"
 #include "crc.h"
+#include "math.h"
+
+#ifdef _STM8_TESTS
+#include <stdio.h>
+#endif
 
 _EXTERN_C
 
@@ -42,4 +47,81 @@ uint8_t _STM8_F(scale_add8)( uint16_t i, fract8 scale, uint16_t add)
       "POPW   X                 \n");
 }
 
+// Every product is an unsigned 8x8 MUL X, A; the two's complement inputs are
+// corrected afterwards by subtracting the other operand from the upper word.
+OPTIMIZE_SPEED
+NO_INLINE
+int32_t _STM8_F(mul16s)( int16_t a, int16_t b)
+{
+  const uint8_t al = (uint8_t)a, ah = (uint8_t)( (uint16_t)a >> 8 );
+  const uint8_t bl = (uint8_t)b, bh = (uint8_t)( (uint16_t)b >> 8 );
+
+  register uint16_t rl = (uint16_t)( (uint16_t)al * bl );
+  register uint16_t rh = (uint16_t)( (uint16_t)ah * bh );
+  register uint16_t m1 = (uint16_t)( (uint16_t)al * bh );
+  register uint16_t m2 = (uint16_t)( (uint16_t)ah * bl );
+
+  m1 += m2;
+  if( m1 < m2 ) rh += 0x100;            // carry out of the middle terms
+
+  m2 = rl;
+  rl += (uint16_t)( m1 << 8 );
+  if( rl < m2 ) ++rh;                   // carry into the upper word
+  rh += m1 >> 8;
+
+  if( a < 0 ) rh -= (uint16_t)b;        // sign correction
+  if( b < 0 ) rh -= (uint16_t)a;
+
+  _stm8_reg32 r;
+  r.w[0] = rh;                          // NOTE: BIG ENDIAN !!
+  r.w[1] = rl;
+  return (int32_t)r.value;
+}
+
 _END_EXTERN_C
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TESTING
+//
+
+#ifdef _STM8_TESTS
+#ifdef __cplusplus
+
+NO_INLINE
+OPTIMIZE_SPEED
+bool _stm8_tests_math()
+{
+  // mul16s, including the corner cases of the sign correction
+  {
+    static const int16_t v[] = { 0, 1, -1, 2, -2, 255, -256, 0x1234,
+                                 -0x1234, 0x7FFF, -0x7FFF, -0x8000 };
+    for( uint8_t i=0; i< sizeof(v)/sizeof(v[0]); ++i)
+      for( uint8_t j=0; j< sizeof(v)/sizeof(v[0]); ++j)
+      {
+        if( _STM8_F(mul16s)( v[i], v[j]) != (int32_t)v[i] * v[j] )
+        {
+          puts("STM/Tests/Math: mul16s failed.");
+          return false;
+        }
+      }
+    putchar('\n');
+  }
+
+  // mulq15
+  {
+    if( _STM8_F(mulq15)( 0x4000, 0x4000) != 0x2000        // 0.5 * 0.5
+     || _STM8_F(mulq15)( -0x8000, 0x4000) != -0x4000      // -1 * 0.5
+     || _STM8_F(mulq15)( -0x8000, -0x8000) != 0x7FFF )    // saturated
+    {
+      puts("STM/Tests/Math: mulq15 failed.");
+      return false;
+    }
+    putchar('\n');
+  }
+
+  return true;
+}
+
+#endif // __cplusplus
+#endif // #ifdef _STM8_TESTS
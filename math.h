@@ -161,8 +161,33 @@ _END_EXTERN_C
 #else
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+// Signed 16x16 => 32 bit multiplication, composed of four 8x8 MUL X,A
+// instructions plus a sign correction of the upper word.
+//
+// NOTE: estimated ~60 cycles incl. calling overhead; a plain (int32_t)a * b
+//       ends up in the much slower IAR library call (see SCALE_ADD8 above).
+
+_EXTERN_C
+
+CONST
+extern int32_t _STM8_F(mul16s)( int16_t a, int16_t b);
+
+_END_EXTERN_C
+
+// Q1.15 fractional multiplication with rounding, i.e. (a * b + 0x4000) >> 15
+// NOTE: -1.0 * -1.0 saturates to 0x7FFF
+ALWAYS_INLINE CONST
+inline int16_t _STM8_F(mulq15)( int16_t a, int16_t b)
+{
+  int32_t p = _STM8_F(mul16s)( a, b) + 0x4000;
+  if( p >= 0x40000000L ) return 0x7FFF;
+  return (int16_t)( p >> 15 );
+}
+
 // this seems to work very well on automatic / stack variables
 // but IAR fails completely with a __tiny volatile global
+// (use _STM8_ATOMIC_INC32 for those)
 // NOTE: BIG ENDIAN !!
 template< typename T>
 ALWAYS_INLINE
@@ -181,6 +206,135 @@ inline void _STM8_F(inc32)(T & l)
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Lock-free counter updates on __tiny (shortmem) globals, e.g. event counters
+// updated from ISRs. No interrupts are masked.
+//
+// Each macro expands to a sequence of single-instruction read-modify-write
+// byte operations, propagating the carry / borrow towards the most significant
+// byte only when needed. The variable must be declared TINY and be visible to
+// the assembler under its plain name (use REQUIRED(var) in the calling
+// function, see timer.c). The jumps are relative to '$' (all instructions
+// used here are 2 bytes), so the macros can be used several times within the
+// same function.
+//
+//  INC16 / INC32:  safe with any number of (nested) writers, as every byte
+//                  INC is atomic and the carries commute.
+//  DEC*, ADD*, SUB*: safe as long as only one context modifies the counter;
+//                  readers in other contexts/ISRs are fine.
+//
+// A reader can still see a carry half propagated. _STM8_F(read32) below
+// handles writers that preempt the reader (ISRs); it can't detect a carry
+// left half done by a preempted lower priority writer.
+//
+// ADD and SUB take an 8-bit constant 1..255; A is preserved.
+//
+// Cycles (common case, i.e. no carry into the upper bytes):
+//  INC16/INC32: 3 cycles; DEC16/DEC32: 7; ADD16/ADD32: 7; SUB16/SUB32: 7
+// plus 2-3 cycles for each byte the carry / borrow propagates into.
+//
+// NOTE: BIG ENDIAN !! i.e. var+3 is the least significant byte of a uint32_t
+
+#define _STM8_ATOMIC_INC16(var)                                                \
+  asm("INC   s:" _STRINGIFY(var) "+1  \n"                                      \
+      "JRNE  $+4                      \n"                                      \
+      "INC   s:" _STRINGIFY(var) "    \n")
+
+#define _STM8_ATOMIC_INC32(var)                                                \
+  asm("INC   s:" _STRINGIFY(var) "+3  \n"                                      \
+      "JRNE  $+12                     \n"                                      \
+      "INC   s:" _STRINGIFY(var) "+2  \n"                                      \
+      "JRNE  $+8                      \n"                                      \
+      "INC   s:" _STRINGIFY(var) "+1  \n"                                      \
+      "JRNE  $+4                      \n"                                      \
+      "INC   s:" _STRINGIFY(var) "    \n")
+
+// a borrow happens when a byte wraps from $00 to $FF
+#define _STM8_ATOMIC_DEC16(var)                                                \
+  asm("PUSH  A                        \n"                                      \
+      "LD    A, #$FF                  \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "+1  \n"                                      \
+      "CP    A, s:" _STRINGIFY(var) "+1 \n"                                    \
+      "JRNE  $+4                      \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "    \n"                                      \
+      "POP   A                        \n")
+
+#define _STM8_ATOMIC_DEC32(var)                                                \
+  asm("PUSH  A                        \n"                                      \
+      "LD    A, #$FF                  \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "+3  \n"                                      \
+      "CP    A, s:" _STRINGIFY(var) "+3 \n"                                    \
+      "JRNE  $+16                     \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "+2  \n"                                      \
+      "CP    A, s:" _STRINGIFY(var) "+2 \n"                                    \
+      "JRNE  $+10                     \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "+1  \n"                                      \
+      "CP    A, s:" _STRINGIFY(var) "+1 \n"                                    \
+      "JRNE  $+4                      \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "    \n"                                      \
+      "POP   A                        \n")
+
+#define _STM8_ATOMIC_ADD16(var, n)                                             \
+  asm("PUSH  A                        \n"                                      \
+      "LD    A, s:" _STRINGIFY(var) "+1 \n"                                    \
+      "ADD   A, #" _STRINGIFY(n) "    \n"                                      \
+      "LD    s:" _STRINGIFY(var) "+1, A \n"                                    \
+      "JRNC  $+4                      \n"                                      \
+      "INC   s:" _STRINGIFY(var) "    \n"                                      \
+      "POP   A                        \n")
+
+#define _STM8_ATOMIC_ADD32(var, n)                                             \
+  asm("PUSH  A                        \n"                                      \
+      "LD    A, s:" _STRINGIFY(var) "+3 \n"                                    \
+      "ADD   A, #" _STRINGIFY(n) "    \n"                                      \
+      "LD    s:" _STRINGIFY(var) "+3, A \n"                                    \
+      "JRNC  $+12                     \n"                                      \
+      "INC   s:" _STRINGIFY(var) "+2  \n"                                      \
+      "JRNE  $+8                      \n"                                      \
+      "INC   s:" _STRINGIFY(var) "+1  \n"                                      \
+      "JRNE  $+4                      \n"                                      \
+      "INC   s:" _STRINGIFY(var) "    \n"                                      \
+      "POP   A                        \n")
+
+#define _STM8_ATOMIC_SUB16(var, n)                                             \
+  asm("PUSH  A                        \n"                                      \
+      "LD    A, s:" _STRINGIFY(var) "+1 \n"                                    \
+      "SUB   A, #" _STRINGIFY(n) "    \n"                                      \
+      "LD    s:" _STRINGIFY(var) "+1, A \n"                                    \
+      "JRNC  $+4                      \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "    \n"                                      \
+      "POP   A                        \n")
+
+#define _STM8_ATOMIC_SUB32(var, n)                                             \
+  asm("PUSH  A                        \n"                                      \
+      "LD    A, s:" _STRINGIFY(var) "+3 \n"                                    \
+      "SUB   A, #" _STRINGIFY(n) "    \n"                                      \
+      "LD    s:" _STRINGIFY(var) "+3, A \n"                                    \
+      "JRNC  $+18                     \n"                                      \
+      "LD    A, #$FF                  \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "+2  \n"                                      \
+      "CP    A, s:" _STRINGIFY(var) "+2 \n"                                    \
+      "JRNE  $+10                     \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "+1  \n"                                      \
+      "CP    A, s:" _STRINGIFY(var) "+1 \n"                                    \
+      "JRNE  $+4                      \n"                                      \
+      "DEC   s:" _STRINGIFY(var) "    \n"                                      \
+      "POP   A                        \n")
+
+// Consistent read of a 32-bit counter that is modified by an ISR, without
+// masking interrupts: read until two consecutive reads agree. A 16-bit LDW
+// is a single instruction and atomic anyway.
+// A retry is only needed if the writer hits exactly between the two reads.
+template< typename T>
+ALWAYS_INLINE
+inline uint32_t _STM8_F(read32)(volatile T & l)
+{
+  register uint32_t a = ((volatile _stm8_reg32&)l).value;
+  register uint32_t b;
+  while( a != ( b = ((volatile _stm8_reg32&)l).value ) ) a = b;
+  return a;
+}
+
 
 // simple calculation of log2(x) in O(log(N))
 // note that log2(0) is undefined
@@ -195,5 +349,15 @@ inline uint8_t _STM8_F(log2)(UINT arg)
   return i;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  TESTING
+//
+
+#ifdef _STM8_TESTS
+#ifdef __cplusplus
+bool _stm8_tests_math();
+#endif
+#endif
 
 #endif // __STM8HAL_MATH_H
\ No newline at end of file
@@ -53,6 +53,7 @@ template<uint8_t PIN, uint8_t _BIT, uint32_t _MASK, typename _GPIO> struct _STM8
 {
   typedef RwReg * port_ptr_t;   // uint8_t
   typedef RwReg   port_t;       // uint8_t
+  typedef _GPIO   gpio_t;       // the port block, see PinGroup
 
   ALWAYS_INLINE
   inline static void setOutput( STM8OutputMode mode = PushPull_Fast )
@@ -142,6 +143,9 @@ _STM8_GPIO;
   static inline volatile _STM8_GPIO * r() { return (_STM8_GPIO *) _STM8_PA(L,A) ; } \
 }
 
+// specialized for every pin of a variant with _STM8_DEF_PIN
+template<uint8_t PIN> struct FastPin;
+
 #define _STM8_DEF_PIN(L, BIT) template<> struct FastPin<P ## L ## BIT> \
   : public _STM8_PIN<P ## L ## BIT, BIT, 1 << BIT, _stm8_gpio_ ## L > { \
   ALWAYS_INLINE \
@@ -180,6 +184,200 @@ _STM8_BLOCK(H,0x5023);
 _STM8_BLOCK(I,0x5028);
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// A group of pins, accessed with a single read-modify-write (or a plain
+// write when all 8 pins are used) per port, so pins on the same port change
+// at the same time. The per-port masks are computed at compile time, ports
+// without pins of the group generate no code.
+//
+//   typedef PinGroup<PC3, PC4, PC5, PD2> Leds;
+//   Leds::setOutput();
+//   Leds::hi();                // PC3..PC5 in one access, PD2 in another
+//   Leds::write(0x05);         // bit i of the value drives the i-th pin
+
+template<typename A, typename B> struct _stm8_same       { enum { value = 0 }; };
+template<typename A>             struct _stm8_same<A, A> { enum { value = 1 }; };
+
+// mask of the pins on port block GPIO
+template<typename GPIO, uint8_t... PINS> struct _stm8_pin_mask;
+template<typename GPIO> struct _stm8_pin_mask<GPIO>
+{
+  static constexpr uint8_t value = 0;
+};
+template<typename GPIO, uint8_t PIN, uint8_t... PINS> struct _stm8_pin_mask<GPIO, PIN, PINS...>
+{
+  static constexpr uint8_t value =
+    ( _stm8_same< typename FastPin<PIN>::gpio_t, GPIO >::value ? FastPin<PIN>::mask() : 0 )
+    | _stm8_pin_mask<GPIO, PINS...>::value;
+};
+
+// bits of the port block GPIO to set for a group value
+template<typename GPIO, uint8_t BIT, uint8_t... PINS> struct _stm8_pin_bits;
+template<typename GPIO, uint8_t BIT> struct _stm8_pin_bits<GPIO, BIT>
+{
+  ALWAYS_INLINE
+  inline static uint8_t get(uint8_t) { return 0; }
+};
+template<typename GPIO, uint8_t BIT, uint8_t PIN, uint8_t... PINS> struct _stm8_pin_bits<GPIO, BIT, PIN, PINS...>
+{
+  ALWAYS_INLINE
+  inline static uint8_t get(uint8_t value)
+  {
+    const uint8_t rest = _stm8_pin_bits<GPIO, BIT + 1, PINS...>::get(value);
+    if( !_stm8_same< typename FastPin<PIN>::gpio_t, GPIO >::value ) return rest;
+    return ( value & ( 1 << BIT ) ) ? ( rest | FastPin<PIN>::mask() ) : rest;
+  }
+};
+
+// per-port operations of PinGroup, M is the group's mask on port block G
+struct _stm8_pin_op_output
+{
+  STM8OutputMode mode;
+  template<typename G, uint8_t M>
+  ALWAYS_INLINE
+  inline void port() const
+  {
+    G::r()->CR2 &= ~M;          // make sure external interrupts are off
+    G::r()->DDR |= M;
+    if( mode & PushPull ) { G::r()->CR1 |= M; } else { G::r()->CR1 &= ~M; }
+    if( mode & FastMode ) { G::r()->CR2 |= M; }
+  }
+};
+
+struct _stm8_pin_op_input
+{
+  STM8InputMode mode;
+  template<typename G, uint8_t M>
+  ALWAYS_INLINE
+  inline void port() const
+  {
+    G::r()->CR2 &= ~M;          // make sure external interrupts are off
+    if( mode & PullUp ) { G::r()->CR1 |= M; } else { G::r()->CR1 &= ~M; }
+    G::r()->DDR &= ~M;          // switch to input
+    if( mode & ExternalInterrupt ) { G::r()->CR2 |= M; }
+  }
+};
+
+struct _stm8_pin_op_hi
+{
+  template<typename G, uint8_t M>
+  ALWAYS_INLINE
+  inline void port() const
+  {
+    if( M == 0xFF ) G::r()->ODR = 0xFF; else G::r()->ODR |= M;
+  }
+};
+
+struct _stm8_pin_op_lo
+{
+  template<typename G, uint8_t M>
+  ALWAYS_INLINE
+  inline void port() const
+  {
+    if( M == 0xFF ) G::r()->ODR = 0x00; else G::r()->ODR &= ~M;
+  }
+};
+
+struct _stm8_pin_op_toggle
+{
+  template<typename G, uint8_t M>
+  ALWAYS_INLINE
+  inline void port() const { G::r()->ODR ^= M; }
+};
+
+template<uint8_t... PINS> struct _stm8_pin_op_write
+{
+  uint8_t value;
+  template<typename G, uint8_t M>
+  ALWAYS_INLINE
+  inline void port() const
+  {
+    const uint8_t bits = _stm8_pin_bits<G, 0, PINS...>::get(value);
+    if( M == 0xFF ) G::r()->ODR = bits;
+    else G::r()->ODR = ( G::r()->ODR & ~M ) | bits;
+  }
+};
+
+template<uint8_t... PINS> struct PinGroup
+{
+  static_assert( sizeof...(PINS) <= 8, "PinGroup: max 8 pins" );
+
+  template<typename GPIO>
+  ALWAYS_INLINE
+  inline static constexpr uint8_t mask() { return _stm8_pin_mask<GPIO, PINS...>::value; }
+
+  ALWAYS_INLINE
+  inline static void setOutput( STM8OutputMode mode = PushPull_Fast )
+  {
+    _stm8_pin_op_output op = { mode };
+    each( op );
+  }
+
+  ALWAYS_INLINE
+  inline static void setInput( STM8InputMode mode = Floating )
+  {
+    _stm8_pin_op_input op = { mode };
+    each( op );
+  }
+
+  ALWAYS_INLINE
+  inline static void hi() { each( _stm8_pin_op_hi() ); }
+  ALWAYS_INLINE
+  inline static void lo() { each( _stm8_pin_op_lo() ); }
+  ALWAYS_INLINE
+  inline static void toggle() { each( _stm8_pin_op_toggle() ); }
+
+  // bit i of value drives the i-th pin of the group
+  ALWAYS_INLINE
+  inline static void write(uint8_t value)
+  {
+    _stm8_pin_op_write<PINS...> op = { value };
+    each( op );
+  }
+
+private:
+  template<typename G, typename OP>
+  ALWAYS_INLINE
+  inline static void one(const OP & op)
+  {
+    if( mask<G>() ) op.template port< G, mask<G>() >();
+  }
+
+  template<typename OP>
+  ALWAYS_INLINE
+  inline static void each(const OP & op)
+  {
+#if defined(PA_ODR_ODR0) || defined(GPIOA)
+    one<_stm8_gpio_A>(op);
+#endif
+#if defined(PB_ODR_ODR0) || defined(GPIOB)
+    one<_stm8_gpio_B>(op);
+#endif
+#if defined(PC_ODR_ODR0) || defined(GPIOC)
+    one<_stm8_gpio_C>(op);
+#endif
+#if defined(PD_ODR_ODR0) || defined(GPIOD)
+    one<_stm8_gpio_D>(op);
+#endif
+#if defined(PE_ODR_ODR0) || defined(GPIOE)
+    one<_stm8_gpio_E>(op);
+#endif
+#if defined(PF_ODR_ODR0) || defined(GPIOF)
+    one<_stm8_gpio_F>(op);
+#endif
+#if defined(PG_ODR_ODR0) || defined(GPIOG)
+    one<_stm8_gpio_G>(op);
+#endif
+#if defined(PH_ODR_ODR0) || defined(GPIOH)
+    one<_stm8_gpio_H>(op);
+#endif
+#if defined(PI_ODR_ODR0) || defined(GPIOI)
+    one<_stm8_gpio_I>(op);
+#endif
+  }
+};
+
 STM8HAL_NAMESPACE_END
 
 #endif // defined(__cplusplus)
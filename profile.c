@@ -0,0 +1,110 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "profile.h"
+
+#include <stdio.h>
+
+_STM8_T(profile) _stm8_profile_table[ _STM8_PROFILE_SLOTS ];
+uint16_t _stm8_profile_overhead = 0;
+
+_EXTERN_C
+
+OPTIMIZE_SPEED
+NO_INTERRUPTS   // interrupts are disabled during execution
+void _STM8_F(profile_add)(uint8_t id, uint16_t start, const char * name)
+{
+  // read the counter first, everything before this is the section's cost
+  uint16_t cycles = _STM8_F(cycles16)() - start;
+  cycles = cycles > _stm8_profile_overhead ? cycles - _stm8_profile_overhead : 0;
+
+  if( id >= _STM8_PROFILE_SLOTS ) return;
+  _STM8_T(profile) * p = &_stm8_profile_table[id];
+
+  if( p->count == 0 )
+  {
+    p->name = name;
+    p->min = p->max = cycles;
+  }
+  else if( p->count == 0xFFFF ) return;
+  else
+  {
+    if( cycles < p->min ) p->min = cycles;
+    if( cycles > p->max ) p->max = cycles;
+  }
+  ++p->count;
+  p->sum += cycles;
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(profile_reset)(void)
+{
+  for( uint8_t i=0; i<_STM8_PROFILE_SLOTS; ++i)
+  {
+    _stm8_profile_table[i].count = 0;
+    _stm8_profile_table[i].sum = 0;
+  }
+}
+
+// The smallest of a few empty sections, so an interrupt in between
+// doesn't spoil the calibration.
+OPTIMIZE_SIZE
+void _STM8_F(profile_calibrate)(void)
+{
+  _stm8_profile_overhead = 0;
+  _STM8_F(profile_reset)();
+  for( uint8_t i=0; i<8; ++i)
+  {
+    PROFILE_BEGIN(0);
+    PROFILE_END(0);
+  }
+  _stm8_profile_overhead = _stm8_profile_table[0].min;
+  _STM8_F(profile_reset)();
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS   // interrupts are disabled during execution
+static void _stm8_profile_copy(_STM8_T(profile) * p, uint8_t id)
+{
+  *p = _stm8_profile_table[id];
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(profile_report)(void)
+{
+  for( uint8_t i=0; i<_STM8_PROFILE_SLOTS; ++i)
+  {
+    _STM8_T(profile) p;
+    _stm8_profile_copy( &p, i );
+    if( !p.count ) continue;
+    printf( "%u %s: n=%u min=%u max=%u mean=%lu\n",
+            i, p.name ? p.name : "", p.count, p.min, p.max,
+            (unsigned long)( p.sum / p.count ) );
+  }
+}
+
+_END_EXTERN_C
@@ -0,0 +1,109 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_PROFILE_H
+#define __STM8HAL_PROFILE_H
+
+#include "debug.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CYCLE PROFILING
+//
+// Sections are measured with the debug.h cycle counter and collected in a
+// static table of min, max and mean cycles per section, e.g.
+//
+//   enum { PROF_ADC, PROF_FILTER };
+//
+//   PROFILE_BEGIN(PROF_FILTER);
+//   ...
+//   PROFILE_END(PROF_FILTER);
+//
+// or, in C++, { Profile p(PROF_FILTER); ... }
+//
+// Call enableCycleCounter() and then profile_calibrate() once, so the cost
+// of the measurement itself is subtracted. A section must be shorter than
+// 65536 cycles (~4ms at 16MHz); see cycles32() for longer ones.
+// profile_add() runs with interrupts disabled, so sections in interrupt
+// handlers and in the main loop can share the table.
+
+#ifndef _STM8_PROFILE_SLOTS
+#define _STM8_PROFILE_SLOTS     8
+#endif
+
+_EXTERN_C
+
+typedef struct
+{
+  const char * name;    // set by the first PROFILE_END
+  uint16_t count;       // saturates at 65535, then sum stops as well
+  uint16_t min;
+  uint16_t max;
+  uint32_t sum;
+}
+_STM8_T(profile);
+
+extern _STM8_T(profile) _stm8_profile_table[ _STM8_PROFILE_SLOTS ];
+extern uint16_t _stm8_profile_overhead;
+
+// Measure the overhead of an empty section.
+void _STM8_F(profile_calibrate)(void);
+
+// Add a measurement of (now - start) cycles to the section.
+void _STM8_F(profile_add)(uint8_t id, uint16_t start, const char * name);
+
+// Clear all statistics, keeping the calibration.
+void _STM8_F(profile_reset)(void);
+
+// Print a line per used section with printf().
+void _STM8_F(profile_report)(void);
+
+_END_EXTERN_C
+
+#define PROFILE_BEGIN(id) \
+  const uint16_t _stm8_profile_start_ ## id = _STM8_F(cycles16)()
+
+#define PROFILE_END(id) \
+  _STM8_F(profile_add)( (id), _stm8_profile_start_ ## id, #id )
+
+#ifdef __cplusplus
+
+class Profile
+{
+  const uint16_t mStart;
+  const uint8_t mId;
+  const char * const mName;
+
+public:
+  ALWAYS_INLINE
+  Profile(uint8_t id, const char * name = 0)
+    : mStart( _STM8_F(cycles16)() ), mId(id), mName(name) {}
+
+  ALWAYS_INLINE
+  ~Profile() { _STM8_F(profile_add)( mId, mStart, mName ); }
+};
+
+#endif // __cplusplus
+
+#endif // __STM8HAL_PROFILE_H
@@ -0,0 +1,88 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "timer.h"
+#include "pt.h"
+#include "load.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+static _STM8_T(pt_fn)   _stm8_pt_task[ _STM8_PT_TASKS ];
+static _STM8_T(pt) *    _stm8_pt_data[ _STM8_PT_TASKS ];
+
+// bit i is set while task i is running, possibly blocked in yield()
+#if _STM8_PT_TASKS > 8
+#error _STM8_PT_TASKS must not exceed 8
+#endif
+static TINY uint8_t     _stm8_pt_busy = 0;
+
+_EXTERN_C
+
+OPTIMIZE_SIZE
+bool _STM8_F(pt_add)(_STM8_T(pt_fn) fn, _STM8_T(pt) * pt)
+{
+  for( uint8_t i=0; i<_STM8_PT_TASKS; ++i)
+  {
+    if( !_stm8_pt_task[i] )
+    {
+      PT_INIT(pt);
+      _stm8_pt_data[i] = pt;
+      _stm8_pt_task[i] = fn;
+      return true;
+    }
+  }
+  return false;
+}
+
+OPTIMIZE_SPEED
+bool _STM8_F(pt_run)(void)
+{
+  bool any = false;
+  uint8_t bit = 1;
+  for( uint8_t i=0; i<_STM8_PT_TASKS; ++i, bit <<= 1)
+  {
+    if( !_stm8_pt_task[i] || ( _stm8_pt_busy & bit ) ) continue;
+    any = true;
+
+    _stm8_pt_busy |= bit;
+    const uint8_t prev = LOAD_TASK(i);
+    const char r = _stm8_pt_task[i]( _stm8_pt_data[i] );
+    (void)LOAD_TASK(prev);
+    _stm8_pt_busy &= ~bit;
+
+    if( r >= PT_EXITED ) _stm8_pt_task[i] = 0;
+  }
+  return any;
+}
+
+OPTIMIZE_SPEED
+void _STM8_F(pt_yield)(void)
+{
+  _STM8_F(pt_run)();
+}
+
+_END_EXTERN_C
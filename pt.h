@@ -0,0 +1,142 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_PT_H
+#define __STM8HAL_PT_H
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// PROTOTHREADS - STACKLESS COOPERATIVE TASKS
+//
+// Based on the "local continuations" by Adam Dunkels: a task is a plain
+// function, and the line number where it last blocked is stored in the task
+// state; the next call jumps back there through a switch statement.
+//
+//    char blink(_stm8_pt * pt)
+//    {
+//      PT_BEGIN(pt);
+//      for(;;) {
+//        led.toggle();
+//        PT_DELAY_MS(pt, 500);
+//      }
+//      PT_END(pt);
+//    }
+//
+// Caveats of the switch based implementation:
+//  - local variables are not preserved while blocked, use static ones
+//  - no switch statements around blocking macros, and at most one blocking
+//    macro per source line
+//  - blocking macros can only be used in the task function itself, not in
+//    functions called from it; see _STM8_PT_YIELD for those
+//
+// RAM: 4 bytes per task state, plus 4 bytes per task in the scheduler table.
+//
+// Requires timer.h for the delay macros.
+
+typedef struct
+{
+  uint16_t lc;          // local continuation, i.e. __LINE__ to resume at
+  uint16_t t;           // start of the current PT_DELAY_MS / PT_DELAY_US
+}
+_STM8_T(pt);
+
+#define PT_WAITING      0
+#define PT_YIELDED      1
+#define PT_EXITED       2
+#define PT_ENDED        3
+
+#define PT_INIT(pt)     do { (pt)->lc = 0; } while(0)
+
+#define PT_BEGIN(pt)    { char _pt_yielded = 1; (void)_pt_yielded; \
+                          switch( (pt)->lc ) { case 0:
+
+#define PT_END(pt)      } _pt_yielded = 0; PT_INIT(pt); return PT_ENDED; }
+
+#define PT_WAIT_UNTIL(pt, cond)                                                \
+  do {                                                                         \
+    (pt)->lc = __LINE__; case __LINE__:                                        \
+    if( !(cond) ) return PT_WAITING;                                           \
+  } while(0)
+
+#define PT_WAIT_WHILE(pt, cond) PT_WAIT_UNTIL( (pt), !(cond) )
+
+// give the other tasks a chance to run once
+#define PT_YIELD(pt)                                                           \
+  do {                                                                         \
+    _pt_yielded = 0;                                                           \
+    (pt)->lc = __LINE__; case __LINE__:                                        \
+    if( _pt_yielded == 0 ) return PT_YIELDED;                                  \
+  } while(0)
+
+#define PT_EXIT(pt)     do { PT_INIT(pt); return PT_EXITED; } while(0)
+#define PT_RESTART(pt)  do { PT_INIT(pt); return PT_WAITING; } while(0)
+
+// non-blocking delays, 1..65535ms and 1..65535us; both are 'at least'
+#define PT_DELAY_MS(pt, ms)                                                    \
+  do {                                                                         \
+    (pt)->t = _STM8_F(millis16)();                                             \
+    PT_WAIT_UNTIL( (pt),                                                       \
+      (uint16_t)( _STM8_F(millis16)() - (pt)->t ) >= (uint16_t)(ms) );         \
+  } while(0)
+
+#define PT_DELAY_US(pt, us)                                                    \
+  do {                                                                         \
+    (pt)->t = _STM8_F(micros16)();                                             \
+    PT_WAIT_UNTIL( (pt),                                                       \
+      (uint16_t)( _STM8_F(micros16)() - (pt)->t ) >= (uint16_t)(us) );         \
+  } while(0)
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SCHEDULER
+//
+// Round robin over a static table of _STM8_PT_TASKS tasks. Finished tasks
+// (PT_END, PT_EXIT) are removed from the table.
+//
+// With _STM8_PT_YIELD defined (e.g. in the STM8HAL_CONF file), yield() runs
+// all other tasks once. As the blocking delays in delay.c call yield() while
+// waiting, a task can then also block in nested functions; the tasks that
+// are currently blocked this way are skipped, so the nesting depth (and the
+// stack usage) is limited by the number of tasks.
+
+#ifndef _STM8_PT_TASKS
+#define _STM8_PT_TASKS  4
+#endif
+
+_EXTERN_C
+
+typedef char (*_STM8_T(pt_fn))(_STM8_T(pt) * pt);
+
+// add a task; returns false if the table is full
+bool _STM8_F(pt_add)(_STM8_T(pt_fn) fn, _STM8_T(pt) * pt);
+
+// run every task once; returns false if no tasks are left
+bool _STM8_F(pt_run)(void);
+
+// run all tasks except the ones currently running once, see _STM8_PT_YIELD
+void _STM8_F(pt_yield)(void);
+
+_END_EXTERN_C
+
+#endif // __STM8HAL_PT_H
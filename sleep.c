@@ -0,0 +1,182 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "timer.h"
+#include "sleep.h"
+#include "isrstat.h"
+
+//uncomment to switch off the main voltage regulator during active-halt
+//(lowest power, but ~50us extra wakeup time)
+//#define _STM8_AWU_REGAH
+
+//uncomment to power down the flash during active-halt
+//#define _STM8_AWU_AHALT
+
+#ifndef _STM8_AWU_MAX_TBR
+#define _STM8_AWU_MAX_TBR 13    // 2^12 * 64 LSI periods, i.e. 2.048s nominal
+#endif
+
+#if defined(__ICCSTM8__)
+
+# define _STM8_AWU_IRQ_VECTOR    AWU_vector
+# define _STM8_AWU_CSR           AWU_CSR1       // AWUF 0x20, AWUEN 0x10
+# define _STM8_AWU_APR           AWU_APR
+# define _STM8_AWU_TBR           AWU_TBR
+# define _STM8_AWU_ICKR          CLK_ICKR       // REGAH 0x20
+# define _STM8_AWU_FLASH_CR1     FLASH_CR1      // AHALT 0x04
+
+#else // check for STM's system header defines
+
+# define _STM8_AWU_IRQ_VECTOR    _Pragma("error Unsupported compiler")
+# define _STM8_AWU_CSR           AWU->CSR
+# define _STM8_AWU_APR           AWU->APR
+# define _STM8_AWU_TBR           AWU->TBR
+# define _STM8_AWU_ICKR          CLK->ICKR
+# define _STM8_AWU_FLASH_CR1     FLASH->CR1
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+// set by the AWU interrupt
+TINY volatile bool _stm8_awu_fired = false;
+
+// nanoseconds per LSI period, i.e. 1e9 / 128kHz until calibrated
+uint16_t _stm8_awu_ns = 7812;
+
+// microseconds slept that didn't make up a full millisecond yet
+TINY uint16_t _stm8_awu_us = 0;
+
+_EXTERN_C
+
+// Interrupt handler for the auto wakeup unit
+OPTIMIZE_SIZE
+INTERRUPT( _STM8_AWU_IRQ_VECTOR )
+void _stm8_awu_wakeup(void)
+{
+  ISR_ENTER( _STM8_AWU_IRQ_VECTOR );
+  (void)_STM8_AWU_CSR;              // reading clears AWUF
+  _stm8_awu_fired = true;
+  ISR_EXIT( _STM8_AWU_IRQ_VECTOR );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// The AWU interval is 2^(TBR-1) * APRDIV LSI periods for TBR 1..13, with
+// APRDIV = APR + 2 in the range 2..64. Pick the shortest TBR for which the
+// requested number of LSI periods can be reached, rounding down.
+// Returns the resulting number of LSI periods.
+//
+OPTIMIZE_SIZE
+static uint32_t _stm8_awu_setup(uint32_t lsi)
+{
+  uint8_t tbr = 1;
+  while( tbr < _STM8_AWU_MAX_TBR && lsi > ( 64ul << ( tbr - 1 ) ) ) ++tbr;
+
+  // clamp before narrowing, with TBR limited lsi can exceed 64 << 12
+  uint32_t div = lsi >> ( tbr - 1 );
+  if( div > 64 ) div = 64;
+  if( div < 2  ) div = 2;
+  const uint8_t aprdiv = (uint8_t)div;
+
+  _STM8_AWU_APR = aprdiv - 2;
+  _STM8_AWU_TBR = tbr;
+  return (uint32_t)aprdiv << ( tbr - 1 );
+}
+
+OPTIMIZE_SIZE
+NO_INLINE
+uint16_t _STM8_F(awu_calibrate)()
+{
+  const uint32_t lsi = _stm8_awu_setup( 2048 );  // 16ms nominal
+
+  _stm8_awu_fired = false;
+  _STM8_AWU_CSR |= 0x10;            // AWUEN, runs in run mode, too
+  while( !_stm8_awu_fired ) wdg();  // synchronize with the AWU counter
+
+  _stm8_awu_fired = false;
+  const uint32_t start = _STM8_F(micros32)();
+  while( !_stm8_awu_fired ) wdg();
+  const uint32_t us = _STM8_F(micros32)() - start;
+
+  _STM8_AWU_CSR &= ~0x10;
+  _stm8_awu_ns = (uint16_t)( us * 1000ul / lsi );
+  return _stm8_awu_ns;
+}
+
+OPTIMIZE_SIZE
+NO_INLINE
+uint16_t _STM8_F(sleep_ms)(uint16_t ms)
+{
+  uint16_t slept = 0;
+
+#ifdef _STM8_AWU_REGAH
+  _STM8_AWU_ICKR |= 0x20;           // REGAH
+#endif
+#ifdef _STM8_AWU_AHALT
+  _STM8_AWU_FLASH_CR1 |= 0x04;      // AHALT
+#endif
+
+  while( slept < ms )
+  {
+    // LSI periods for the remaining time, using the calibration; more than
+    // 4s at a time would overflow, and the AWU can't do more than 2s anyway
+    uint16_t remaining = ms - slept;
+    if( remaining > 4000 ) remaining = 4000;
+    const uint32_t want = (uint32_t)remaining * 1000000ul / _stm8_awu_ns;
+    const uint32_t lsi = _stm8_awu_setup( want ? want : 1 );
+
+    _stm8_awu_fired = false;
+    _STM8_AWU_CSR |= 0x10;          // AWUEN
+    halt();                         // TIM4 stops, resumes on wakeup
+    _STM8_AWU_CSR &= ~0x10;
+
+    if( !_stm8_awu_fired ) break;   // woken by something else
+
+    // advance the millisecond counter by the calibrated time slept
+    uint32_t us = lsi * _stm8_awu_ns / 1000ul + _stm8_awu_us;
+    uint16_t m = (uint16_t)( us / 1000 );
+    _stm8_awu_us = (uint16_t)( us - (uint32_t)m * 1000 );
+
+    disableInterrupts();
+    _stm8_time_elapsed.value += m;
+    enableInterrupts();
+
+    slept += m;
+  }
+
+#ifdef _STM8_AWU_AHALT
+  _STM8_AWU_FLASH_CR1 &= ~0x04;
+#endif
+#ifdef _STM8_AWU_REGAH
+  _STM8_AWU_ICKR &= ~0x20;
+#endif
+
+  return slept;
+}
+
+_END_EXTERN_C
@@ -0,0 +1,72 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_SLEEP_H
+#define __STM8HAL_SLEEP_H
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TICKLESS SLEEP, BASED ON THE AUTO WAKEUP UNIT (AWU) AND ACTIVE-HALT
+//
+// Instead of waking up 1000 times per second for the TIM4 tick, the MCU
+// enters active-halt and the AWU (clocked by the 128kHz LSI) wakes it up once
+// per sleep interval. All other clocks, including TIM4, are stopped; the TIM4
+// counter keeps its phase. On wakeup, _stm8_time_elapsed is advanced by the
+// time slept, so millis()/micros() continue as if the timer had been ticking.
+//
+// The LSI is only accurate to about +/-12.5%, so it should be measured
+// against the (crystal or HSI) based TIM4 tick with _STM8_F(awu_calibrate)
+// once after startup, and again when temperature or supply voltage change.
+//
+// Wakeups per second:
+//   always ticking:        1000
+//   sleep_ms(N), N<=2048:  1 per N ms, plus 1 for every further 2048ms
+//
+// Current draw depends on the part; see IDD(AH) vs. IDD(RUN) in the
+// datasheet. Active-halt with the main voltage regulator off
+// (_STM8_AWU_REGAH) and flash powered down (_STM8_AWU_AHALT) is in the
+// single digit uA range, compared to several mA in run mode.
+//
+// NOTE: Any other interrupt (e.g. an external pin) also ends active-halt.
+//       The AWU counter can't be read, so the time slept until then is not
+//       known; sleep_ms() then only accounts for completed AWU intervals
+//       and returns early. Define _STM8_AWU_MAX_TBR (1..13) to limit the
+//       interval length and thereby the time that can get lost.
+
+_EXTERN_C
+
+// Measure the LSI against micros32(); takes ~35ms, requires the timer to be
+// enabled. Returns the nanoseconds per LSI period (nominal 7812).
+NO_INLINE
+uint16_t _STM8_F(awu_calibrate)();
+
+// Sleep in active-halt for (at most) the given number of milliseconds and
+// keep millis/micros up to date. Returns the milliseconds actually slept,
+// which can be less when woken by another interrupt.
+NO_INLINE
+uint16_t _STM8_F(sleep_ms)(uint16_t ms);
+
+_END_EXTERN_C
+
+#endif // __STM8HAL_SLEEP_H
@@ -0,0 +1,217 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "pin.h"
+#include "isrstat.h"
+#include "spi.h"
+
+#if defined(__ICCSTM8__)
+
+# define _STM8_SPI_IRQ_VECTOR    SPI_RXNE_vector
+# define _STM8_SPI_CR1           SPI_CR1        // SPE 0x40, MSTR 0x04
+# define _STM8_SPI_CR2           SPI_CR2        // CRCEN 0x20, CRCNEXT 0x10, SSM 0x02, SSI 0x01
+# define _STM8_SPI_ICR           SPI_ICR        // RXIE 0x40
+# define _STM8_SPI_SR            SPI_SR         // BSY 0x80, OVR 0x40, CRCERR 0x10, TXE 0x02, RXNE 0x01
+# define _STM8_SPI_DR            SPI_DR
+# define _STM8_SPI_CRCPR         SPI_CRCPR
+# define _STM8_SPI_RXCRCR        SPI_RXCRCR
+# define _STM8_SPI_TXCRCR        SPI_TXCRCR
+# define _STM8_SPI_CGR           CLK_PCKENR1    // clock gating register
+# define _STM8_SPI_CGR_MASK      (1<<1)
+
+#else // check for STM's system header defines
+
+# define _STM8_SPI_IRQ_VECTOR    _Pragma("error Unsupported compiler")
+# define _STM8_SPI_CR1           SPI->CR1
+# define _STM8_SPI_CR2           SPI->CR2
+# define _STM8_SPI_ICR           SPI->ICR
+# define _STM8_SPI_SR            SPI->SR
+# define _STM8_SPI_DR            SPI->DR
+# define _STM8_SPI_CRCPR         SPI->CRCPR
+# define _STM8_SPI_RXCRCR        SPI->RXCRCR
+# define _STM8_SPI_TXCRCR        SPI->TXCRCR
+# define _STM8_SPI_CGR           CLK->PCKENR1
+# define _STM8_SPI_CGR_MASK      (1<<1)
+
+#endif
+
+#define _STM8_SPI_SPE           0x40
+#define _STM8_SPI_MSTR          0x04
+#define _STM8_SPI_CRCEN         0x20
+#define _STM8_SPI_SSM           0x02
+#define _STM8_SPI_SSI           0x01
+#define _STM8_SPI_RXIE          0x40
+#define _STM8_SPI_BSY           0x80
+#define _STM8_SPI_CRCERR        0x10
+#define _STM8_SPI_TXE           0x02
+#define _STM8_SPI_RXNE          0x01
+
+////////////////////////////////////////////////////////////////////////////////
+
+// non-blocking transfer, bytes left including the one in flight
+static const uint8_t * _stm8_spi_tx;
+static uint8_t * _stm8_spi_rx;
+static volatile uint16_t _stm8_spi_left = 0;
+static _STM8_T(spi_cb) _stm8_spi_done;
+
+// Wait for the last byte to leave the shift register.
+OPTIMIZE_SIZE
+static void _stm8_spi_idle(void)
+{
+  while( !( _STM8_SPI_SR & _STM8_SPI_TXE ) ) {}
+  while( _STM8_SPI_SR & _STM8_SPI_BSY ) {}
+}
+
+_EXTERN_C
+
+// Interrupt handler for the non-blocking transfer: the byte in flight has
+// been received, the next one goes out.
+OPTIMIZE_SPEED
+INTERRUPT( _STM8_SPI_IRQ_VECTOR )
+void _stm8_spi_update(void)
+{
+  ISR_ENTER( _STM8_SPI_IRQ_VECTOR );
+
+  const uint8_t c = _STM8_SPI_DR;       // clears RXNE
+  if( _stm8_spi_rx ) *_stm8_spi_rx++ = c;
+
+  if( --_stm8_spi_left )
+    _STM8_SPI_DR = _stm8_spi_tx ? *_stm8_spi_tx++ : _STM8_SPI_FILL;
+  else
+  {
+    _STM8_SPI_ICR &= ~_STM8_SPI_RXIE;
+    if( _stm8_spi_done ) _stm8_spi_done();
+  }
+
+  ISR_EXIT( _STM8_SPI_IRQ_VECTOR );
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(spi_init)(uint8_t cr1)
+{
+  _STM8_SPI_CGR |= _STM8_SPI_CGR_MASK;
+  _STM8_SPI_CR1 = 0;
+  _STM8_SPI_ICR = 0;
+  _STM8_SPI_CR2 = _STM8_SPI_SSM | _STM8_SPI_SSI;  // NSS in software, no mode fault
+  _STM8_SPI_CR1 = cr1 | _STM8_SPI_MSTR;
+  _STM8_SPI_CR1 |= _STM8_SPI_SPE;
+
+#if defined(__cplusplus) && defined(PIN_SPI_SCK) && defined(PIN_SPI_MOSI)
+  // the alternate function outputs follow the port's slope control, past
+  // 2MHz they need fast mode
+  FastPin< PIN_SPI_SCK >::setOutput( PushPull_Fast );
+  FastPin< PIN_SPI_MOSI >::setOutput( PushPull_Fast );
+#endif
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(spi_end)(void)
+{
+  while( _stm8_spi_left ) {}
+  _stm8_spi_idle();
+  _STM8_SPI_CR1 &= ~_STM8_SPI_SPE;
+}
+
+OPTIMIZE_SPEED
+uint8_t _STM8_F(spi_transfer8)(uint8_t c)
+{
+  while( !( _STM8_SPI_SR & _STM8_SPI_TXE ) ) {}
+  _STM8_SPI_DR = c;
+  while( !( _STM8_SPI_SR & _STM8_SPI_RXNE ) ) {}
+  return _STM8_SPI_DR;
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS
+bool _STM8_F(spi_transfer_async)(const uint8_t * tx, uint8_t * rx, uint16_t n, _STM8_T(spi_cb) done)
+{
+  if( _stm8_spi_left ) return false;
+  if( !n )
+  {
+    if( done ) done();
+    return true;
+  }
+
+  _stm8_spi_tx = tx;
+  _stm8_spi_rx = rx;
+  _stm8_spi_left = n;
+  _stm8_spi_done = done;
+
+  (void)_STM8_SPI_DR;                   // drop anything stale
+  (void)_STM8_SPI_SR;
+  _STM8_SPI_ICR |= _STM8_SPI_RXIE;
+  _STM8_SPI_DR = _stm8_spi_tx ? *_stm8_spi_tx++ : _STM8_SPI_FILL;
+  return true;
+}
+
+bool _STM8_F(spi_busy)(void)
+{
+  return _stm8_spi_left != 0;
+}
+
+// CRCEN may only be changed with the SPI disabled; changing it resets the
+// CRC registers.
+OPTIMIZE_SIZE
+void _STM8_F(spi_crc_begin)(uint8_t poly)
+{
+  _stm8_spi_idle();
+  _STM8_SPI_CR1 &= ~_STM8_SPI_SPE;
+  _STM8_SPI_CR2 &= ~_STM8_SPI_CRCEN;
+  _STM8_SPI_CRCPR = poly;
+  _STM8_SPI_CR2 |= _STM8_SPI_CRCEN;
+  _STM8_SPI_CR1 |= _STM8_SPI_SPE;
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(spi_crc_end)(void)
+{
+  _stm8_spi_idle();
+  _STM8_SPI_CR1 &= ~_STM8_SPI_SPE;
+  _STM8_SPI_CR2 &= ~_STM8_SPI_CRCEN;
+  _STM8_SPI_CR1 |= _STM8_SPI_SPE;
+}
+
+uint8_t _STM8_F(spi_crc_tx)(void)
+{
+  return _STM8_SPI_TXCRCR;
+}
+
+uint8_t _STM8_F(spi_crc_rx)(void)
+{
+  return _STM8_SPI_RXCRCR;
+}
+
+OPTIMIZE_SIZE
+bool _STM8_F(spi_crc_error)(void)
+{
+  if( !( _STM8_SPI_SR & _STM8_SPI_CRCERR ) ) return false;
+  _STM8_SPI_SR = (uint8_t)~_STM8_SPI_CRCERR;       // rc_w0
+  return true;
+}
+
+_END_EXTERN_C
@@ -0,0 +1,166 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+
+#ifndef __STM8HAL_SPI_H
+#define __STM8HAL_SPI_H
+
+#include "stm8hal.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SPI MASTER
+//
+// Three ways of moving data, all on the same setup from spi_begin():
+//
+//  - burst, spi_burst.asm: spi_write(), spi_read() and spi_transfer() poll
+//    the flags in tight loops (9 to 13 cycles per byte), so the data
+//    register is refilled before the shift register runs dry and bytes go
+//    out back-to-back, also at the fastest clock of F_CPU/2, i.e. 16 cycles
+//    per byte. spi_read() and spi_transfer() hold off interrupts while
+//    running, as a late read loses a byte to overrun; split long ones up.
+//    spi_write() leaves interrupts enabled, they only stretch the clock.
+//  - non-blocking, spi.c: spi_transfer_async() moves one byte per RXNE
+//    interrupt and calls back when done. One byte is in flight at a time,
+//    so the bus idles for the interrupt latency between bytes.
+//  - CRC: the peripheral computes a CRC-8 of both directions while
+//    transferring, at no cost. spi_write_crc() appends the TX CRC to a
+//    burst; spi_crc_error() tells if a received CRC didn't match.
+//
+// Wait for !spi_busy() before starting a burst after a non-blocking
+// transfer. Chip select is left to the application, e.g. with
+// _STM8_T(spi_select)<PIN> in C++.
+
+#define SPI_MODE0               0x00    // CPOL 0, CPHA 0
+#define SPI_MODE1               0x01    // CPOL 0, CPHA 1
+#define SPI_MODE2               0x02    // CPOL 1, CPHA 0
+#define SPI_MODE3               0x03    // CPOL 1, CPHA 1
+#define SPI_MSBFIRST            0x00
+#define SPI_LSBFIRST            0x80
+
+#ifndef _STM8_SPI_FILL
+#define _STM8_SPI_FILL          0xFF    // sent by spi_read()
+#endif
+
+// CR1 baud rate bits BR[2:0] for the fastest clock F_CPU/2^(BR+1) <= hz
+#define _STM8_SPI_BR(hz) \
+  ( (F_CPU) /   2 <= (hz) ? 0 : (F_CPU) /   4 <= (hz) ? 1 : \
+    (F_CPU) /   8 <= (hz) ? 2 : (F_CPU) /  16 <= (hz) ? 3 : \
+    (F_CPU) /  32 <= (hz) ? 4 : (F_CPU) /  64 <= (hz) ? 5 : \
+    (F_CPU) / 128 <= (hz) ? 6 : 7 )
+
+_EXTERN_C
+
+typedef void (*_STM8_T(spi_cb))(void);
+
+// Enable the SPI master with CR1 bits: BR[2:0] << 3, SPI_MODEn, SPI_xSBFIRST;
+// see spi_begin().
+void _STM8_F(spi_init)(uint8_t cr1);
+
+// Disable the SPI, once the last byte is out.
+void _STM8_F(spi_end)(void);
+
+// Send and receive one byte.
+uint8_t _STM8_F(spi_transfer8)(uint8_t c);
+
+// Send n bytes, the received ones are dropped. Returns with the bus idle.
+void _STM8_F(spi_write)(const uint8_t * buf, uint16_t n);
+
+// Receive n bytes into buf, sending _STM8_SPI_FILL.
+void _STM8_F(spi_read)(uint8_t * buf, uint16_t n);
+
+// Send the n bytes of buf, replacing them with the ones received.
+void _STM8_F(spi_transfer)(uint8_t * buf, uint16_t n);
+
+// Start a transfer of n bytes and return. tx may be NULL to send
+// _STM8_SPI_FILL, rx may be NULL to drop the received bytes. done, if not
+// NULL, is called from the interrupt handler at the end, e.g. to release
+// chip select. Returns false if a transfer is still running.
+bool _STM8_F(spi_transfer_async)(const uint8_t * tx, uint8_t * rx, uint16_t n, _STM8_T(spi_cb) done);
+
+// A non-blocking transfer is running.
+bool _STM8_F(spi_busy)(void);
+
+// Enable the hardware CRC with a polynomial (e.g. 0x07 for CRC-8), and
+// reset it. Waits for the bus to be idle.
+void _STM8_F(spi_crc_begin)(uint8_t poly);
+
+// Disable the hardware CRC.
+void _STM8_F(spi_crc_end)(void);
+
+// As spi_write(), followed by the TX CRC of all bytes sent since
+// spi_crc_begin().
+void _STM8_F(spi_write_crc)(const uint8_t * buf, uint16_t n);
+
+// CRC of the bytes sent, received since spi_crc_begin().
+uint8_t _STM8_F(spi_crc_tx)(void);
+uint8_t _STM8_F(spi_crc_rx)(void);
+
+// A received CRC byte didn't match (clears the flag).
+bool _STM8_F(spi_crc_error)(void);
+
+// Enable the SPI master at the fastest clock up to hz, in SPI_MODEn, MSB
+// first unless SPI_LSBFIRST is or'ed in.
+ALWAYS_INLINE
+inline void _STM8_F(spi_begin)(uint32_t hz, uint8_t mode)
+{
+  _STM8_F(spi_init)( (uint8_t)( _STM8_SPI_BR(hz) << 3 ) | mode );
+}
+
+_END_EXTERN_C
+
+#if defined(__cplusplus)
+
+#include "pin.h"
+
+// Chip select on a FastPin, active (low) while in scope:
+//
+//   _STM8_T(spi_select)<PA3>::begin();   // once, deselected
+//   { _STM8_T(spi_select)<PA3> cs; spi_write( frame, sizeof(frame) ); }
+//
+// The burst functions return with the bus idle, so the destructor can
+// release it right away.
+template<uint8_t CS>
+struct _STM8_T(spi_select)
+{
+  ALWAYS_INLINE
+  inline static void begin()
+  {
+    FastPin<CS>::hi();
+    FastPin<CS>::setOutput( PushPull_Fast );
+  }
+  ALWAYS_INLINE
+  inline static void select()   { FastPin<CS>::lo(); }
+  ALWAYS_INLINE
+  inline static void deselect() { FastPin<CS>::hi(); }
+
+  ALWAYS_INLINE
+  inline _STM8_T(spi_select)()  { select(); }
+  ALWAYS_INLINE
+  inline ~_STM8_T(spi_select)() { deselect(); }
+};
+
+#endif // __cplusplus
+
+#endif // __STM8HAL_SPI_H
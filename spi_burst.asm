@@ -0,0 +1,150 @@
+#include "vregs.inc"
+
+#define _STM8HAL_INTERNAL
+#include "stm8hal.h"
+
+; keep in sync with spi.h
+#ifndef _STM8_SPI_FILL
+#define _STM8_SPI_FILL          0xFF
+#endif
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+        MODULE  spi_burst
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+        PUBLIC  _STM8_F(spi_write)
+        PUBLIC  _STM8_F(spi_write_crc)
+        PUBLIC  _STM8_F(spi_read)
+        PUBLIC  _STM8_F(spi_transfer)
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+        ; define a CODE NOROOT section with 2^2 alignment
+        SECTION `.near_func.text`:CODE:NOROOT(2)
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;
+; SPI_SR: BSY bit 7, TXE bit 1, RXNE bit 0; SPI_CR2: CRCNEXT bit 4
+;
+; At F_CPU/2 a byte takes 16 cycles on the bus. The data register and the
+; shift register form a two byte queue, so the loops just need to be
+; shorter than that to keep it from running dry.
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;
+; extern "C" void spi_write(const uint8_t * buf, uint16_t n);
+; extern "C" void spi_write_crc(const uint8_t * buf, uint16_t n);
+;
+; X: buf, Y: n. Received bytes are dropped, the overrun flag is cleared at
+; the end. spi_write_crc() sets CRCNEXT right after the last byte went into
+; the data register, so the CRC follows without a gap.
+; 9 cycles per byte, interrupts stay enabled.
+
+_STM8_F(spi_write_crc):
+        MOV     ?b0, #1                 ; longmem, no shortmem,#imm form
+        JRA     _write
+_STM8_F(spi_write):
+        CLR     s:?b0
+_write:
+        TNZW    Y
+        JREQ    _write_idle
+_write_loop:
+        LD      A, (X)                  ; 1cy
+        INCW    X                       ; 1cy
+        BTJF    SPI_SR, #1, $           ; 2cy   TXE
+        LD      SPI_DR, A               ; 1cy
+        DECW    Y                       ; 2cy
+        JRNE    _write_loop             ; 2cy
+
+        TNZ     s:?b0
+        JREQ    _write_idle
+        BSET    SPI_CR2, #4             ; CRCNEXT
+_write_idle:
+        BTJF    SPI_SR, #1, $           ; TXE
+        BTJT    SPI_SR, #7, $           ; BSY
+        BRES    SPI_CR2, #4             ; CRCNEXT, back to data
+        LD      A, SPI_DR               ; reading DR, then SR clears OVR
+        LD      A, SPI_SR
+        RET
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;
+; extern "C" void spi_read(uint8_t * buf, uint16_t n);
+;
+; X: buf, Y: n. Sends _STM8_SPI_FILL. With the next byte queued before the
+; previous one is read, each byte must be read within 16 cycles of RXNE,
+; so interrupts are held off.
+; 11 cycles per byte.
+
+_STM8_F(spi_read):
+        TNZW    Y
+        JREQ    _read_done
+        PUSH    CC
+        SIM
+        LD      A, SPI_DR               ; drop anything stale
+        LD      A, SPI_SR
+        MOV     SPI_DR, #_STM8_SPI_FILL ; first byte, straight to the shift register
+        DECW    Y
+        JREQ    _read_last
+_read_loop:
+        BTJF    SPI_SR, #1, $           ; 2cy   TXE
+        MOV     SPI_DR, #_STM8_SPI_FILL ; 1cy   queue the next
+        BTJF    SPI_SR, #0, $           ; 2cy   RXNE of the previous
+        LD      A, SPI_DR               ; 1cy
+        LD      (X), A                  ; 1cy
+        INCW    X                       ; 1cy
+        DECW    Y                       ; 2cy
+        JRNE    _read_loop              ; 2cy
+_read_last:
+        BTJF    SPI_SR, #0, $           ; RXNE
+        LD      A, SPI_DR
+        LD      (X), A
+        POP     CC
+_read_done:
+        RET
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;
+; extern "C" void spi_transfer(uint8_t * buf, uint16_t n);
+;
+; X: buf, Y: n. Full duplex in place: byte i+1 is queued from (1,X) before
+; byte i is received into (X). Interrupts are held off as in spi_read().
+; 13 cycles per byte.
+
+_STM8_F(spi_transfer):
+        TNZW    Y
+        JREQ    _transfer_done
+        PUSH    CC
+        SIM
+        LD      A, SPI_DR               ; drop anything stale
+        LD      A, SPI_SR
+        LD      A, (X)
+        LD      SPI_DR, A               ; first byte, straight to the shift register
+        DECW    Y
+        JREQ    _transfer_last
+_transfer_loop:
+        LD      A, (1,X)                ; 1cy
+        BTJF    SPI_SR, #1, $           ; 2cy   TXE
+        LD      SPI_DR, A               ; 1cy   queue the next
+        BTJF    SPI_SR, #0, $           ; 2cy   RXNE of the previous
+        LD      A, SPI_DR               ; 1cy
+        LD      (X), A                  ; 1cy
+        INCW    X                       ; 1cy
+        DECW    Y                       ; 2cy
+        JRNE    _transfer_loop          ; 2cy
+_transfer_last:
+        BTJF    SPI_SR, #0, $           ; RXNE
+        LD      A, SPI_DR
+        LD      (X), A
+        POP     CC
+_transfer_done:
+        RET
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+        END
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
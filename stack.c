@@ -0,0 +1,96 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "isrstat.h"
+#include "stack.h"
+
+// lowest address seen overwritten, 0 until painted
+static uint8_t * _stm8_stack_mark = 0;
+
+#ifdef _STM8_STACK_ISR
+// lowest stack pointer seen at the entry of each vector
+static uint8_t * _stm8_stack_isr_sp[ _STM8_ISR_VECTORS ];
+#endif
+
+_EXTERN_C
+
+OPTIMIZE_SIZE
+NO_INLINE
+void _STM8_F(stack_paint)(void)
+{
+  volatile uint8_t here;
+  uint8_t * const end = (uint8_t *)&here - _STM8_STACK_MARGIN;
+  for( uint8_t * p = _STM8_STACK_BEGIN; p < end; ++p) *p = _STM8_STACK_PATTERN;
+  _stm8_stack_mark = end;
+}
+
+OPTIMIZE_SIZE
+uint16_t _STM8_F(stack_size)(void)
+{
+  return (uint16_t)( _STM8_STACK_END - _STM8_STACK_BEGIN );
+}
+
+OPTIMIZE_SPEED
+uint16_t _STM8_F(stack_used)(void)
+{
+  if( !_stm8_stack_mark ) return 0;     // not painted
+
+  // the first byte from the bottom not holding the pattern
+  uint8_t * p = _STM8_STACK_BEGIN;
+  while( p < _stm8_stack_mark && *p == _STM8_STACK_PATTERN ) ++p;
+  _stm8_stack_mark = p;
+  return (uint16_t)( _STM8_STACK_END - p );
+}
+
+OPTIMIZE_SPEED
+NO_INLINE
+void _STM8_F(stack_sample)(uint8_t vector)
+{
+#ifdef _STM8_STACK_ISR
+  volatile uint8_t here;
+  if( vector >= _STM8_ISR_VECTORS ) return;
+  uint8_t * sp = (uint8_t *)&here;
+  if( !_stm8_stack_isr_sp[ vector ] || sp < _stm8_stack_isr_sp[ vector ] )
+    _stm8_stack_isr_sp[ vector ] = sp;
+#else
+  (void)vector;
+#endif
+}
+
+OPTIMIZE_SIZE
+uint16_t _STM8_F(stack_isr_depth)(uint8_t vector)
+{
+#ifdef _STM8_STACK_ISR
+  if( vector < _STM8_ISR_VECTORS && _stm8_stack_isr_sp[ vector ] )
+    return (uint16_t)( _STM8_STACK_END - _stm8_stack_isr_sp[ vector ] );
+#else
+  (void)vector;
+#endif
+  return 0;
+}
+
+_END_EXTERN_C
@@ -0,0 +1,87 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_STACK_H
+#define __STM8HAL_STACK_H
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// STACK USAGE
+//
+// stack_paint() fills the free part of the stack with a pattern, best as
+// the first thing in main(). stack_used() then finds the high-water mark,
+// the deepest the stack has ever grown, by scanning up from the bottom for
+// the first overwritten byte. The scan only covers the part never used,
+// which is short exactly when it matters.
+//
+// With _STM8_STACK_ISR defined, ISR_ENTER (isrstat.h) also samples the stack
+// depth at the entry of each instrumented interrupt handler, i.e. the worst
+// case of the interrupted code plus the handler's entry frame; see
+// stack_isr_depth().
+//
+// The stack is the linker's CSTACK block, it grows down from its end.
+// Kernel task stacks (kernel.h) are not covered.
+// NOTE: Interrupts may use the stack while it's being painted, so a margin
+//       below the current stack pointer is left alone.
+
+#ifndef _STM8_STACK_PATTERN
+#define _STM8_STACK_PATTERN     0xCD
+#endif
+
+#ifndef _STM8_STACK_MARGIN
+#define _STM8_STACK_MARGIN      16      // bytes below SP not painted
+#endif
+
+#if defined(__ICCSTM8__)
+#pragma section = "CSTACK"
+# define _STM8_STACK_BEGIN      ( (uint8_t *)__section_begin("CSTACK") )
+# define _STM8_STACK_END        ( (uint8_t *)__section_end("CSTACK") )
+#else
+# ifndef _STM8_STACK_BEGIN
+#  define _STM8_STACK_BEGIN     _Pragma("error Unsupported compiler")
+#  define _STM8_STACK_END       _Pragma("error Unsupported compiler")
+# endif
+#endif
+
+_EXTERN_C
+
+// Fill the unused stack below the caller with the pattern.
+void _STM8_F(stack_paint)(void);
+
+// Size of the stack in bytes.
+uint16_t _STM8_F(stack_size)(void);
+
+// Deepest stack use since stack_paint(), in bytes.
+uint16_t _STM8_F(stack_used)(void);
+
+// Record the stack depth at an interrupt handler's entry, see isrstat.h.
+void _STM8_F(stack_sample)(uint8_t vector);
+
+// Deepest stack at the entry of the handler for vector, in bytes,
+// 0 if it never ran or isn't instrumented.
+uint16_t _STM8_F(stack_isr_depth)(uint8_t vector);
+
+_END_EXTERN_C
+
+#endif // __STM8HAL_STACK_H
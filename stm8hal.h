@@ -86,7 +86,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
   #define STM8HAL_NAMESPACE_END
 
   #ifndef yield
+  #  ifdef _STM8_PT_YIELD
+  // run other protothreads while waiting, see pt.h
+  _EXTERN_C
+  void _STM8_F(pt_yield)(void);
+  _END_EXTERN_C
+  #  define yield() _STM8_F(pt_yield)()
+  #  else
   #  define yield() do {} while(0)
+  #  endif
   #endif
 
   #ifndef wdg
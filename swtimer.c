@@ -0,0 +1,168 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "timer.h"
+#include "swtimer.h"
+
+#if _STM8_SWTIMER_WHEEL & ( _STM8_SWTIMER_WHEEL - 1 )
+#error _STM8_SWTIMER_WHEEL must be a power of 2
+#endif
+
+#define _STM8_SWTIMER_NONE      0xFF
+#define _STM8_SWTIMER_MASK      ( _STM8_SWTIMER_WHEEL - 1 )
+
+////////////////////////////////////////////////////////////////////////////////
+
+// timer slots
+static uint16_t               _stm8_swt_deadline[ _STM8_SWTIMERS ];
+static _STM8_T(swtimer_cb)    _stm8_swt_cb[ _STM8_SWTIMERS ];
+static uint8_t                _stm8_swt_next[ _STM8_SWTIMERS ];
+static uint8_t                _stm8_swt_prev[ _STM8_SWTIMERS ];
+
+// list heads, one per bucket; initialized on first use
+static uint8_t                _stm8_swt_bucket[ _STM8_SWTIMER_WHEEL ];
+
+// the last millisecond processed, and the number of armed timers
+static TINY uint16_t          _stm8_swt_now;
+static TINY uint8_t           _stm8_swt_armed;
+static TINY bool              _stm8_swt_init = false;
+
+_EXTERN_C
+
+OPTIMIZE_SIZE
+static void _stm8_swt_setup()
+{
+  for( uint8_t i=0; i<_STM8_SWTIMER_WHEEL; ++i)
+    _stm8_swt_bucket[i] = _STM8_SWTIMER_NONE;
+  for( uint8_t i=0; i<_STM8_SWTIMERS; ++i)
+    _stm8_swt_prev[i] = _stm8_swt_next[i] = _STM8_SWTIMER_NONE;
+  _stm8_swt_now = _STM8_F(millis16)();
+  _stm8_swt_init = true;
+}
+
+// a slot is armed iff it's the head of its bucket or has a predecessor
+OPTIMIZE_SPEED
+static bool _stm8_swt_linked(uint8_t id)
+{
+  return _stm8_swt_prev[id] != _STM8_SWTIMER_NONE
+      || _stm8_swt_bucket[ _stm8_swt_deadline[id] & _STM8_SWTIMER_MASK ] == id;
+}
+
+OPTIMIZE_SPEED
+static void _stm8_swt_unlink(uint8_t id)
+{
+  const uint8_t n = _stm8_swt_next[id];
+  const uint8_t p = _stm8_swt_prev[id];
+  if( p != _STM8_SWTIMER_NONE ) _stm8_swt_next[p] = n;
+  else _stm8_swt_bucket[ _stm8_swt_deadline[id] & _STM8_SWTIMER_MASK ] = n;
+  if( n != _STM8_SWTIMER_NONE ) _stm8_swt_prev[n] = p;
+  _stm8_swt_next[id] = _stm8_swt_prev[id] = _STM8_SWTIMER_NONE;
+  --_stm8_swt_armed;
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(swtimer_set)(uint8_t id, _STM8_T(swtimer_cb) cb)
+{
+  if( !_stm8_swt_init ) _stm8_swt_setup();
+  _stm8_swt_cb[id] = cb;
+}
+
+OPTIMIZE_SPEED
+NO_INTERRUPTS   // interrupts are disabled during execution
+void _STM8_F(swtimer_arm)(uint8_t id, uint16_t delay)
+{
+  if( _stm8_swt_linked(id) ) _stm8_swt_unlink(id);
+
+  if( delay == 0 ) delay = 1;
+  if( delay > 0x7FFF ) delay = 0x7FFF;
+
+  // relative to real time; all ticks up to then will still be processed
+  const uint16_t deadline = _STM8_F(millis16)() + delay;
+  const uint8_t b = deadline & _STM8_SWTIMER_MASK;
+
+  _stm8_swt_deadline[id] = deadline;
+  _stm8_swt_next[id] = _stm8_swt_bucket[b];
+  if( _stm8_swt_bucket[b] != _STM8_SWTIMER_NONE )
+    _stm8_swt_prev[ _stm8_swt_bucket[b] ] = id;
+  _stm8_swt_bucket[b] = id;
+  ++_stm8_swt_armed;
+}
+
+OPTIMIZE_SPEED
+NO_INTERRUPTS   // interrupts are disabled during execution
+void _STM8_F(swtimer_cancel)(uint8_t id)
+{
+  if( _stm8_swt_linked(id) ) _stm8_swt_unlink(id);
+}
+
+OPTIMIZE_SIZE
+bool _STM8_F(swtimer_armed)(uint8_t id)
+{
+  return _stm8_swt_linked(id);
+}
+
+// Fire everything due at _stm8_swt_now. The bucket is rescanned after each
+// callback, as the callback may have modified it.
+OPTIMIZE_SPEED
+static void _stm8_swt_expire()
+{
+  const uint8_t b = _stm8_swt_now & _STM8_SWTIMER_MASK;
+  uint8_t id = _stm8_swt_bucket[b];
+  while( id != _STM8_SWTIMER_NONE )
+  {
+    if( _stm8_swt_deadline[id] == _stm8_swt_now )
+    {
+      _stm8_swt_unlink(id);
+      _stm8_swt_cb[id](id);
+      id = _stm8_swt_bucket[b];
+    }
+    else id = _stm8_swt_next[id];
+  }
+}
+
+OPTIMIZE_SPEED
+void _STM8_F(swtimer_tick)()
+{
+  ++_stm8_swt_now;
+  if( _stm8_swt_armed ) _stm8_swt_expire();
+}
+
+OPTIMIZE_SPEED
+void _STM8_F(swtimer_poll)()
+{
+  if( !_stm8_swt_init ) _stm8_swt_setup();
+
+  const uint16_t now = _STM8_F(millis16)();
+  while( _stm8_swt_now != now )
+  {
+    if( !_stm8_swt_armed ) { _stm8_swt_now = now; break; }
+    ++_stm8_swt_now;
+    _stm8_swt_expire();
+  }
+}
+
+_END_EXTERN_C
@@ -0,0 +1,94 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_SWTIMER_H
+#define __STM8HAL_SWTIMER_H
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SOFTWARE TIMERS, HASHED TIMER WHEEL ON THE MILLISECOND TICK
+//
+// A fixed number of statically allocated timer slots, identified by their
+// index 0.._STM8_SWTIMERS-1. Each armed timer is linked into the wheel bucket
+// (deadline % _STM8_SWTIMER_WHEEL); every millisecond only the one bucket
+// for the current tick is looked at, so:
+//
+//  - arm / cancel are O(1) (doubly linked lists, 8-bit indices)
+//  - a tick with an empty bucket costs a load and a compare, a tick with no
+//    timers armed at all costs nothing but the test of a counter
+//  - deadlines are 16-bit millis, compared for equality only, so they wrap
+//    around safely; delays are limited to 1..32767ms
+//
+// Timers due in a later revolution of the wheel stay in their bucket and are
+// skipped when their deadline doesn't match.
+//
+// Two ways of driving the wheel:
+//
+//  - from the main loop: call _STM8_F(swtimer_poll)() as often as possible;
+//    it catches up with millis16(), so callbacks run late, but never early,
+//    and in normal (non-interrupt) context
+//  - from the TIM4 interrupt: define _STM8_SWTIMER_ISR when compiling
+//    timer.c; callbacks then run inside the ISR and must be short
+//
+// Callbacks may arm or cancel any timer, including their own (periodic).
+// Timers should only be armed or cancelled from the context that drives the
+// wheel, or, with _STM8_SWTIMER_ISR, from anywhere.
+//
+// RAM: 6 bytes per slot + 1 byte per wheel bucket + 4 bytes
+
+#ifndef _STM8_SWTIMERS
+#define _STM8_SWTIMERS          8       // max 254
+#endif
+
+#ifndef _STM8_SWTIMER_WHEEL
+#define _STM8_SWTIMER_WHEEL     16      // buckets, must be a power of 2
+#endif
+
+_EXTERN_C
+
+typedef void (*_STM8_T(swtimer_cb))(uint8_t id);
+
+// assign the callback, required once before arming
+void _STM8_F(swtimer_set)(uint8_t id, _STM8_T(swtimer_cb) cb);
+
+// (re)start a timer to fire once, delay ms from now
+NO_INTERRUPTS
+void _STM8_F(swtimer_arm)(uint8_t id, uint16_t delay);
+
+// stop a timer; nothing happens if it isn't armed
+NO_INTERRUPTS
+void _STM8_F(swtimer_cancel)(uint8_t id);
+
+bool _STM8_F(swtimer_armed)(uint8_t id);
+
+// process all milliseconds up to now; call from the main loop
+void _STM8_F(swtimer_poll)();
+
+// process exactly one millisecond; called from the timer ISR with
+// _STM8_SWTIMER_ISR
+void _STM8_F(swtimer_tick)();
+
+_END_EXTERN_C
+
+#endif // __STM8HAL_SWTIMER_H
@@ -0,0 +1,319 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "debug.h"
+#include "pin.h"
+#include "isrstat.h"
+#include "swuart.h"
+
+#if !defined(__cplusplus)
+#error swuart.c uses FastPin, compile as C++
+#endif
+
+#if !defined(_STM8_SWUART_TX_PIN) || !defined(_STM8_SWUART_RX_PIN)
+#error Define _STM8_SWUART_TX_PIN and _STM8_SWUART_RX_PIN, see swuart.h
+#endif
+
+#ifndef _STM8_SWUART_RX_CHANNEL
+#define _STM8_SWUART_RX_CHANNEL 2       // PD3 on most parts
+#endif
+
+// The other two channels sample RX and time TX
+#if _STM8_SWUART_RX_CHANNEL == 1
+# define _STM8_SWUART_SMP_CHANNEL 2
+# define _STM8_SWUART_TX_CHANNEL  3
+#elif _STM8_SWUART_RX_CHANNEL == 2
+# define _STM8_SWUART_SMP_CHANNEL 3
+# define _STM8_SWUART_TX_CHANNEL  1
+#elif _STM8_SWUART_RX_CHANNEL == 3
+# define _STM8_SWUART_SMP_CHANNEL 1
+# define _STM8_SWUART_TX_CHANNEL  2
+#else
+# error _STM8_SWUART_RX_CHANNEL must be 1, 2 or 3
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Capture/compare channels of the TIM2/5 cycle counter, see debug.h
+//
+#define _STM8_SWUART_CCER_1      CCER1   // CC1E 0x01, CC1P 0x02
+#define _STM8_SWUART_CCER_2      CCER1   // CC2E 0x10, CC2P 0x20
+#define _STM8_SWUART_CCER_3      CCER2   // CC3E 0x01, CC3P 0x02
+
+#if defined(__ICCSTM8__)
+
+# define _STM8_SWUART_IRQ_VECTOR _GLUE( _STM8_CYCLES, _CAPCOM_CC1IF_vector )
+# define _STM8_SWUART_CCMR(n)    _GLUE3( _STM8_CYCLES, _CCMR, n )
+# define _STM8_SWUART_CCER(n)    _GLUE3( _STM8_CYCLES, _, _GLUE( _STM8_SWUART_CCER_, n ) )
+# define _STM8_SWUART_CCRH(n)    _GLUE( _GLUE3( _STM8_CYCLES, _CCR, n ), H )
+# define _STM8_SWUART_CCRL(n)    _GLUE( _GLUE3( _STM8_CYCLES, _CCR, n ), L )
+# define _STM8_SWUART_SR2        _GLUE( _STM8_CYCLES, _SR2 )  // CCnOF 1<<n
+
+#else // check for STM's system header defines
+
+# define _STM8_SWUART_IRQ_VECTOR _Pragma("error Unsupported compiler")
+# define _STM8_SWUART_CCMR(n)    _STM8_CYCLES->_GLUE( CCMR, n )
+# define _STM8_SWUART_CCER(n)    _STM8_CYCLES->_GLUE( _STM8_SWUART_CCER_, n )
+# define _STM8_SWUART_CCRH(n)    _STM8_CYCLES->_GLUE3( CCR, n, H )
+# define _STM8_SWUART_CCRL(n)    _STM8_CYCLES->_GLUE3( CCR, n, L )
+# define _STM8_SWUART_SR2        _STM8_CYCLES->SR2
+
+#endif
+
+#define _STM8_SWUART_CCE(n)     ( (n) == 2 ? 0x10 : 0x01 )      // enable
+#define _STM8_SWUART_CCP(n)     ( (n) == 2 ? 0x20 : 0x02 )      // falling edge
+
+// CCnIE in IER, CCnIF in SR1
+#define _STM8_SWUART_RX_FLAG    ( 1 << _STM8_SWUART_RX_CHANNEL )
+#define _STM8_SWUART_SMP_FLAG   ( 1 << _STM8_SWUART_SMP_CHANNEL )
+#define _STM8_SWUART_TX_FLAG    ( 1 << _STM8_SWUART_TX_CHANNEL )
+
+// SR1 is rc_w0: writing a 1 leaves a flag alone, so each flag can be cleared
+// by a plain write without a read-modify-write race with the others.
+#define _STM8_SWUART_CLEAR(flag) ( _STM8_CYCLES_SR1 = (uint8_t)~(flag) )
+
+// Cycles from starting a transmission to its start bit
+#define _STM8_SWUART_TX_LEAD    100
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef FastPin< _STM8_SWUART_TX_PIN > _stm8_swuart_tx_pin;
+typedef FastPin< _STM8_SWUART_RX_PIN > _stm8_swuart_rx_pin;
+
+static uint8_t _stm8_swuart_tx_buffer[ _STM8_SWUART_TX_SIZE ];
+static uint8_t _stm8_swuart_rx_buffer[ _STM8_SWUART_RX_SIZE ];
+TINY volatile uint8_t _stm8_swuart_tx_head = 0;
+TINY volatile uint8_t _stm8_swuart_tx_tail = 0;
+TINY volatile uint8_t _stm8_swuart_rx_head = 0;
+TINY volatile uint8_t _stm8_swuart_rx_tail = 0;
+TINY volatile uint8_t _stm8_swuart_rx_lost = 0;
+TINY volatile uint8_t _stm8_swuart_rx_errors = 0;
+
+// cycles per bit, and from the start edge to the middle of the first data bit
+static uint16_t _stm8_swuart_bit;
+static uint16_t _stm8_swuart_first;
+
+// TX: the bits still to go out (LSB next, then the stop bit), 0 between
+// bytes; the time of the next bit boundary
+static TINY uint16_t _stm8_swuart_tx_frame = 0;
+static TINY uint16_t _stm8_swuart_tx_time;
+static TINY volatile bool _stm8_swuart_tx_busy = false;
+
+// RX: data bits sampled so far, LSB first; the time of the next sample
+static TINY uint8_t _stm8_swuart_rx_shift;
+static TINY uint8_t _stm8_swuart_rx_count;
+static TINY uint16_t _stm8_swuart_rx_time;
+
+// Compare registers: H first, the compare is inhibited until L is written
+#define _STM8_SWUART_SET_CCR(n, t) \
+  do { _STM8_SWUART_CCRH(n) = (uint8_t)( (t) >> 8 ); _STM8_SWUART_CCRL(n) = (uint8_t)(t); } while(0)
+
+_EXTERN_C
+
+// Interrupt handler for the capture/compare channels of TIM2/5. TX goes
+// first, its edges need the least jitter.
+OPTIMIZE_SPEED
+INTERRUPT( _STM8_SWUART_IRQ_VECTOR )
+void _stm8_swuart_update(void)
+{
+  ISR_ENTER( _STM8_SWUART_IRQ_VECTOR );
+
+  const uint8_t pending = _STM8_CYCLES_SR1 & _STM8_CYCLES_IER;
+
+  if( pending & _STM8_SWUART_TX_FLAG )
+  {
+    _STM8_SWUART_CLEAR( _STM8_SWUART_TX_FLAG );
+    register uint16_t frame = _stm8_swuart_tx_frame;
+    if( frame )
+    {
+      if( frame & 1 ) _stm8_swuart_tx_pin::hi(); else _stm8_swuart_tx_pin::lo();
+      frame >>= 1;
+    }
+    else if( _stm8_swuart_tx_tail != _stm8_swuart_tx_head )
+    {
+      _stm8_swuart_tx_pin::lo();                                // start bit
+      register uint8_t tail = _stm8_swuart_tx_tail;
+      frame = _stm8_swuart_tx_buffer[ tail & ( _STM8_SWUART_TX_SIZE - 1 ) ] | 0x100;  // stop bit
+      _stm8_swuart_tx_tail = ++tail;
+    }
+    else
+    {
+      // the stop bit is over, nothing left to send
+      _STM8_CYCLES_IER &= ~_STM8_SWUART_TX_FLAG;
+      _stm8_swuart_tx_busy = false;
+    }
+    _stm8_swuart_tx_frame = frame;
+    _stm8_swuart_tx_time += _stm8_swuart_bit;
+    _STM8_SWUART_SET_CCR( _STM8_SWUART_TX_CHANNEL, _stm8_swuart_tx_time );
+  }
+
+  if( pending & _STM8_SWUART_SMP_FLAG )
+  {
+    _STM8_SWUART_CLEAR( _STM8_SWUART_SMP_FLAG );
+    const bool level = _stm8_swuart_rx_pin::gpio_t::r()->IDR & _stm8_swuart_rx_pin::mask();
+    if( _stm8_swuart_rx_count < 8 )
+    {
+      _stm8_swuart_rx_shift >>= 1;
+      if( level ) _stm8_swuart_rx_shift |= 0x80;
+      ++_stm8_swuart_rx_count;
+      _stm8_swuart_rx_time += _stm8_swuart_bit;
+      _STM8_SWUART_SET_CCR( _STM8_SWUART_SMP_CHANNEL, _stm8_swuart_rx_time );
+    }
+    else
+    {
+      // stop bit
+      register uint8_t head = _stm8_swuart_rx_head;
+      if( !level )
+        ++_stm8_swuart_rx_errors;
+      else if( (uint8_t)( head - _stm8_swuart_rx_tail ) < _STM8_SWUART_RX_SIZE )
+      {
+        _stm8_swuart_rx_buffer[ head & ( _STM8_SWUART_RX_SIZE - 1 ) ] = _stm8_swuart_rx_shift;
+        _stm8_swuart_rx_head = ++head;
+      }
+      else
+        ++_stm8_swuart_rx_lost;
+
+      // wait for the next start bit, forgetting the edges of this byte
+      _STM8_CYCLES_IER &= ~_STM8_SWUART_SMP_FLAG;
+      _STM8_SWUART_CLEAR( _STM8_SWUART_RX_FLAG );
+      _STM8_SWUART_SR2 = (uint8_t)~_STM8_SWUART_RX_FLAG;      // overcapture
+      _STM8_CYCLES_IER |= _STM8_SWUART_RX_FLAG;
+    }
+  }
+
+  if( pending & _STM8_SWUART_RX_FLAG )
+  {
+    // start bit; reading CCRL clears the flag
+    const uint8_t hi = _STM8_SWUART_CCRH( _STM8_SWUART_RX_CHANNEL );
+    const uint16_t t = ( (uint16_t)hi << 8 ) | _STM8_SWUART_CCRL( _STM8_SWUART_RX_CHANNEL );
+    _stm8_swuart_rx_count = 0;
+    _stm8_swuart_rx_time = t + _stm8_swuart_first;
+    _STM8_SWUART_SET_CCR( _STM8_SWUART_SMP_CHANNEL, _stm8_swuart_rx_time );
+    _STM8_SWUART_CLEAR( _STM8_SWUART_SMP_FLAG );
+    _STM8_CYCLES_IER = ( _STM8_CYCLES_IER & ~_STM8_SWUART_RX_FLAG ) | _STM8_SWUART_SMP_FLAG;
+  }
+
+  ISR_EXIT( _STM8_SWUART_IRQ_VECTOR );
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS
+void _STM8_F(swuart_init)(uint16_t bit)
+{
+  enableCycleCounter();
+
+  if( bit > _STM8_SWUART_BIT_MAX ) bit = _STM8_SWUART_BIT_MAX;  // 1.5 bits in 16 bits
+  _stm8_swuart_bit = bit;
+  _stm8_swuart_first = bit + ( bit >> 1 ) - _STM8_SWUART_RX_LATENCY;
+  _stm8_swuart_tx_head = _stm8_swuart_tx_tail = 0;
+  _stm8_swuart_rx_head = _stm8_swuart_rx_tail = 0;
+  _stm8_swuart_rx_lost = _stm8_swuart_rx_errors = 0;
+  _stm8_swuart_tx_frame = 0;
+  _stm8_swuart_tx_busy = false;
+
+  _stm8_swuart_tx_pin::hi();                                    // idle
+  _stm8_swuart_tx_pin::setOutput( PushPull_Fast );
+  _stm8_swuart_rx_pin::setInput( PullUp );
+
+  _STM8_CYCLES_IER &= ~( _STM8_SWUART_RX_FLAG | _STM8_SWUART_SMP_FLAG | _STM8_SWUART_TX_FLAG );
+
+  // CCnS may only be written with the channel disabled
+  _STM8_SWUART_CCER( _STM8_SWUART_RX_CHANNEL ) &= ~_STM8_SWUART_CCE( _STM8_SWUART_RX_CHANNEL );
+  _STM8_SWUART_CCER( _STM8_SWUART_SMP_CHANNEL ) &= ~_STM8_SWUART_CCE( _STM8_SWUART_SMP_CHANNEL );
+  _STM8_SWUART_CCER( _STM8_SWUART_TX_CHANNEL ) &= ~_STM8_SWUART_CCE( _STM8_SWUART_TX_CHANNEL );
+  _STM8_SWUART_CCMR( _STM8_SWUART_RX_CHANNEL ) = 0x21;         // ICF=0x20 4 samples, CCnS=0x01 input TIn
+  _STM8_SWUART_CCMR( _STM8_SWUART_SMP_CHANNEL ) = 0x00;        // frozen output compare
+  _STM8_SWUART_CCMR( _STM8_SWUART_TX_CHANNEL ) = 0x00;
+  _STM8_SWUART_CCER( _STM8_SWUART_RX_CHANNEL ) |=
+    _STM8_SWUART_CCE( _STM8_SWUART_RX_CHANNEL ) | _STM8_SWUART_CCP( _STM8_SWUART_RX_CHANNEL );
+
+  _STM8_SWUART_CLEAR( _STM8_SWUART_RX_FLAG );
+  _STM8_SWUART_SR2 = (uint8_t)~_STM8_SWUART_RX_FLAG;
+  _STM8_CYCLES_IER |= _STM8_SWUART_RX_FLAG;
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS
+void _STM8_F(swuart_end)(void)
+{
+  _STM8_CYCLES_IER &= ~( _STM8_SWUART_RX_FLAG | _STM8_SWUART_SMP_FLAG | _STM8_SWUART_TX_FLAG );
+  _STM8_SWUART_CCER( _STM8_SWUART_RX_CHANNEL ) &= ~_STM8_SWUART_CCE( _STM8_SWUART_RX_CHANNEL );
+  _stm8_swuart_tx_pin::hi();
+  _stm8_swuart_tx_tail = _stm8_swuart_tx_head;
+  _stm8_swuart_rx_tail = _stm8_swuart_rx_head;
+  _stm8_swuart_tx_frame = 0;
+  _stm8_swuart_tx_busy = false;
+}
+
+// Schedule the first start bit, unless the interrupt is already running.
+OPTIMIZE_SIZE
+NO_INTERRUPTS
+static void _stm8_swuart_tx_start(void)
+{
+  if( _stm8_swuart_tx_busy ) return;
+  _stm8_swuart_tx_busy = true;
+  _stm8_swuart_tx_time = _STM8_F(cycles16)() + _STM8_SWUART_TX_LEAD;
+  _STM8_SWUART_SET_CCR( _STM8_SWUART_TX_CHANNEL, _stm8_swuart_tx_time );
+  _STM8_SWUART_CLEAR( _STM8_SWUART_TX_FLAG );
+  _STM8_CYCLES_IER |= _STM8_SWUART_TX_FLAG;
+}
+
+OPTIMIZE_SPEED
+void _STM8_F(swuart_write)(uint8_t c)
+{
+  register uint8_t head = _stm8_swuart_tx_head;
+  while( (uint8_t)( head - _stm8_swuart_tx_tail ) >= _STM8_SWUART_TX_SIZE )
+  {
+    wdg();
+    yield();
+  }
+  _stm8_swuart_tx_buffer[ head & ( _STM8_SWUART_TX_SIZE - 1 ) ] = c;
+  _stm8_swuart_tx_head = ++head;        // publish after the data
+  _stm8_swuart_tx_start();
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(swuart_flush)(void)
+{
+  while( _stm8_swuart_tx_busy )
+  {
+    wdg();
+    yield();
+  }
+}
+
+OPTIMIZE_SPEED
+int16_t _STM8_F(swuart_read)(void)
+{
+  register uint8_t tail = _stm8_swuart_rx_tail;
+  if( tail == _stm8_swuart_rx_head ) return -1;
+  const uint8_t c = _stm8_swuart_rx_buffer[ tail & ( _STM8_SWUART_RX_SIZE - 1 ) ];
+  _stm8_swuart_rx_tail = ++tail;        // release the slot after reading it
+  return c;
+}
+
+_END_EXTERN_C
@@ -0,0 +1,134 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+
+#ifndef __STM8HAL_SWUART_H
+#define __STM8HAL_SWUART_H
+
+#include "stm8hal.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// SOFTWARE UART
+//
+// A second serial channel, 8N1, on any two pins, for when the UART pins are
+// taken (e.g. the 8-pin STM8S001J3, where they share pads with SWIM).
+// Timed by the free running TIM2/5 cycle counter (debug.h), which keeps
+// counting for cycles16()/cycles32() meanwhile:
+//
+//   RX  The falling edge of the start bit is captured on the TIM2/5 channel
+//       of the RX pin (_STM8_SWUART_RX_CHANNEL), with a compare on a second
+//       channel then interrupting in the middle of each bit to sample it.
+//   TX  A compare on the third channel interrupts at each bit boundary,
+//       where the next level goes out on a FastPin first thing.
+//
+// The compare channels have their outputs disabled, so their pins stay free.
+// Define in the STM8HAL_CONF file, e.g. for the STM8S001J3:
+//
+//   #define _STM8_SWUART_TX_PIN      PC3   // pin 7, any pin
+//   #define _STM8_SWUART_RX_PIN      PA3   // pin 5, TIM2_CH3
+//   #define _STM8_SWUART_RX_CHANNEL  3
+//
+// CPU OVERHEAD, estimated from instruction counts: each bit is one interrupt
+// of roughly 60 cycles including entry and exit, ~600 cycles per byte and
+// direction. Streaming in one direction that is ~45% of the CPU at 115200
+// baud and 16MHz, ~5% at 9600. Full duplex at 115200 leaves little for the
+// application; up to 57600 it's fine.
+//
+// Other interrupts delay the bit interrupts, which shows as jitter of the TX
+// edges and RX sampling points. At 115200 and 16MHz a bit is 139 cycles;
+// keep interrupt handlers of the same or higher priority short (or lower
+// their priority in the ITC) when going this fast.
+
+#ifndef _STM8_SWUART_TX_SIZE
+#define _STM8_SWUART_TX_SIZE    16      // power of 2, 128 max
+#endif
+
+#ifndef _STM8_SWUART_RX_SIZE
+#define _STM8_SWUART_RX_SIZE    16      // power of 2, 128 max
+#endif
+
+#if ( _STM8_SWUART_TX_SIZE & ( _STM8_SWUART_TX_SIZE - 1 ) ) || _STM8_SWUART_TX_SIZE > 128
+#error _STM8_SWUART_TX_SIZE must be a power of 2, 128 max
+#endif
+
+#if ( _STM8_SWUART_RX_SIZE & ( _STM8_SWUART_RX_SIZE - 1 ) ) || _STM8_SWUART_RX_SIZE > 128
+#error _STM8_SWUART_RX_SIZE must be a power of 2, 128 max
+#endif
+
+// Cycles from the compare match to the RX pin being read, subtracted from
+// the sampling points so they fall in the middle of the bits.
+#ifndef _STM8_SWUART_RX_LATENCY
+#define _STM8_SWUART_RX_LATENCY 20
+#endif
+
+// Cycles per bit, rounded to nearest. 1.5 bits must fit 16 bits of counter,
+// i.e. 366 baud min at 16MHz; swuart_init() clamps to _STM8_SWUART_BIT_MAX.
+#define _STM8_SWUART_BIT(baud)  ( ( (F_CPU) + (baud) / 2 ) / (baud) )
+#define _STM8_SWUART_BIT_MAX    43690
+
+_EXTERN_C
+
+extern TINY volatile uint8_t _stm8_swuart_tx_head;   // written by swuart_write()
+extern TINY volatile uint8_t _stm8_swuart_tx_tail;   // written by the ISR
+extern TINY volatile uint8_t _stm8_swuart_rx_head;   // written by the ISR
+extern TINY volatile uint8_t _stm8_swuart_rx_tail;   // written by swuart_read()
+extern TINY volatile uint8_t _stm8_swuart_rx_lost;   // full buffer
+extern TINY volatile uint8_t _stm8_swuart_rx_errors; // framing errors
+
+// Start the cycle counter and the software UART with a bit time in cycles,
+// up to _STM8_SWUART_BIT_MAX, see swuart_begin().
+void _STM8_F(swuart_init)(uint16_t bit);
+
+// Stop the software UART, pending bytes are dropped.
+void _STM8_F(swuart_end)(void);
+
+// Queue a byte for transmission, waits while the buffer is full.
+void _STM8_F(swuart_write)(uint8_t c);
+
+// Wait until the stop bit of the last byte has gone out.
+void _STM8_F(swuart_flush)(void);
+
+// The next received byte, or -1 when none is available.
+int16_t _STM8_F(swuart_read)(void);
+
+// Number of received bytes waiting.
+ALWAYS_INLINE
+inline uint8_t _STM8_F(swuart_available)(void)
+{
+  return (uint8_t)( _stm8_swuart_rx_head - _stm8_swuart_rx_tail );
+}
+
+// Start the software UART at a baud rate, 115200 max at 16MHz. Rates too
+// low for the 16-bit counter run at the lowest possible one.
+ALWAYS_INLINE
+inline void _STM8_F(swuart_begin)(uint32_t baud)
+{
+  const uint32_t bit = _STM8_SWUART_BIT(baud);
+  _STM8_F(swuart_init)( bit > _STM8_SWUART_BIT_MAX ? _STM8_SWUART_BIT_MAX : (uint16_t)bit );
+}
+
+_END_EXTERN_C
+
+#endif // __STM8HAL_SWUART_H
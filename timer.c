@@ -27,10 +27,29 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "timer.h"
 #include "pin.h"
 #include "math.h"
+#include "isrstat.h"
 
 //uncomment to toggle pin on every timer interrupt / C++ only!
 //#define _STM8_TIMER_DEBUG_PIN PB4
 
+//uncomment to drive the software timers (swtimer.h) from the interrupt
+//#define _STM8_SWTIMER_ISR
+
+#ifdef _STM8_SWTIMER_ISR
+#include "swtimer.h"
+#endif
+
+//uncomment to run the preemptive kernel (kernel.h) from the interrupt
+//#define _STM8_KERNEL
+
+#ifdef _STM8_KERNEL
+#include "kernel.h"
+#endif
+
+#ifdef _STM8_LOAD
+#include "load.h"
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Our timer is based on either TIM4 or TIM6, which for our purposes are
 // functionally identical. Hardware implements either one or the other.
@@ -100,6 +119,25 @@ FastPin< _STM8_TIMER_DEBUG_PIN > _stm8_timer_debug_pin;
 // millisecond counter
 TINY volatile _stm8_reg32 _stm8_time_elapsed = { 0ul };
 
+#if _STM8_TIMER_PERIOD_FRAC
+// Bresenham accumulator for the fractional counts per millisecond,
+// in units of 1/1000 counts
+TINY uint16_t _stm8_timer_frac = 0;
+#endif
+
+// Microseconds into the current millisecond for a given counter value,
+// i.e. ctr * _STM8_TIMER_US_Q8 >> 8, using 8x8 multiplications only.
+// Always < 1000 as the counter never exceeds _STM8_TIMER_PERIOD.
+OPTIMIZE_SPEED
+ALWAYS_INLINE
+static inline uint16_t _stm8_timer_ticks_to_us(uint8_t ctr)
+{
+  register uint16_t us = (uint16_t)ctr * _STM8_TIMER_US_INT;
+  if( _STM8_TIMER_US_FRAC )
+    us += (uint16_t)( (uint16_t)ctr * _STM8_TIMER_US_FRAC ) >> 8;
+  return us;
+}
+
 _EXTERN_C
 
 // Interrupt handler for the TIM4 or TIM6 update interrupt
@@ -108,6 +146,14 @@ REQUIRED(_stm8_time_elapsed)
 INTERRUPT( _STM8_TIMER_IRQ_VECTOR )
 void _stm8_timer_update(void)
 {
+  ISR_ENTER( _STM8_TIMER_IRQ_VECTOR );
+#ifdef _STM8_LOAD
+  _STM8_F(load_tick)();                 // ends idle time, see load.h
+#endif
+  // the counter started at 0 with the update event
+  ISR_LATENCY( _STM8_TIMER_IRQ_VECTOR,
+               (uint16_t)_STM8_TIMER_COUNTER << _STM8_TIMER_PSC );
+
 #ifdef _STM8_TIMER_DEBUG_PIN
 #ifdef __cplusplus
   _stm8_timer_debug_pin.toggle();
@@ -124,17 +170,34 @@ void _stm8_timer_update(void)
 
   //  ++millis_elapsed.value;
   // _stm8_inc32 is a total fail in this case!
-  //_stm8_inc32(_stm8_time_elapsed);
-  asm("INC   s:_stm8_time_elapsed+3   \n"
-      "JRNE  done                     \n"
-      "INC   s:_stm8_time_elapsed+2   \n"
-      "JRNE  done                     \n"
-      "INC   s:_stm8_time_elapsed+1   \n"
-      "JRNE  done                     \n"
-      "INC   s:_stm8_time_elapsed     \n"
-      "done:                          \n");
+  _STM8_ATOMIC_INC32(_stm8_time_elapsed);
+
+#if _STM8_TIMER_PERIOD_FRAC
+  // Distribute the fractional counts: the counter has just restarted, so
+  // (without ARPE) the new reload value applies to the period just begun.
+  _stm8_timer_frac += _STM8_TIMER_PERIOD_FRAC;
+  if( _stm8_timer_frac >= 1000 )
+  {
+    _stm8_timer_frac -= 1000;
+    _STM8_TIMER_ARR = _STM8_TIMER_PERIOD;       // PERIOD+1 counts
+  }
+  else
+  {
+    _STM8_TIMER_ARR = _STM8_TIMER_PERIOD - 1;   // PERIOD counts
+  }
+#endif
 
   _STM8_TIMER_SR1 &= ~0x01;             // UIF=0x01, clear flag
+
+#ifdef _STM8_SWTIMER_ISR
+  _STM8_F(swtimer_tick)();
+#endif
+
+  ISR_EXIT( _STM8_TIMER_IRQ_VECTOR );   // before switching stacks
+
+#ifdef _STM8_KERNEL
+  if( _STM8_F(kernel_tick)() ) _STM8_F(kernel_switch)();
+#endif
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -156,9 +219,9 @@ void _STM8_F(enable_timer)()
   // Peripheral clock gating register
   _STM8_TIMER_CGR |= _STM8_TIMER_CGR_MASK;
 
-  // TODO: Use F_CPU to maximize RELOAD/PERIOD
-  _STM8_TIMER_PRESCALER = 6;  // 1<<6 == 64, e.g.  16,000,000 / 64  = 250,000
-  _STM8_TIMER_ARR = 249;   // period (250-1), e.g. 250,000 / 250 = 1,000
+  // see timer.h, e.g. 16,000,000 / 64 = 250,000; 250,000 / 250 = 1,000
+  _STM8_TIMER_PRESCALER = _STM8_TIMER_PSC;
+  _STM8_TIMER_ARR = _STM8_TIMER_PERIOD - 1;
 
   _STM8_TIMER_IER |= 0x01;     // UIE=0x01, Enable Update Interrupt
   //_STM8_TIMER_SR1 &= ~0x01;    // UIF=0x01, clear any pending updates
@@ -186,14 +249,20 @@ uint32_t _STM8_F(millis32)()
   return m;
 }
 
+// A pending update (UIF set, ISR not yet run) means the millisecond counter
+// is one behind. The update may have happened just after ctr was read, so
+// with UIF set ctr is read again, which is then surely in the new period.
+// This holds however long interrupts were masked, up to a full period.
+#define _STM8_TIMER_PENDING(ctr) \
+  ( ( _STM8_TIMER_SR1 & 0x01 ) && ( (ctr) = _STM8_TIMER_COUNTER, true ) )
+
 OPTIMIZE_SPEED
 NO_INTERRUPTS   // interrupts are disabled during execution
 uint16_t _STM8_F(micros16)()
 {
   register uint16_t m = _stm8_time_elapsed.w[1];
-  if( _STM8_TIMER_SR1 & 0x01 ) ++m; // 16-bit!!
-
   uint8_t ctr = _STM8_TIMER_COUNTER;
+  if( _STM8_TIMER_PENDING(ctr) ) ++m; // 16-bit!!
 
 #ifdef _STM8_SIMULATOR_
   // The simulator doesn't simulate the timer, only the interrupt
@@ -201,9 +270,98 @@ uint16_t _STM8_F(micros16)()
   if( ++_STM8_TIMER_COUNTER == 0 ) ++m; // 16-bit!!
 #endif
 
-  // m has now millis, and we add a 10bit microsecond value
-  // by multiplying the counter value (0..255) by 4.
-  return ( ((uint16_t)( m << 8 )) | ctr ) << 2 | ( ctr >> 6 );
+  // m has now millis; m * 1000 == m * 1024 - m * 16 - m * 8 (16-bit!!)
+  m = (uint16_t)( m << 3 );
+  m = (uint16_t)( ( m << 7 ) - ( m << 1 ) - m );
+  return m + _stm8_timer_ticks_to_us( ctr );
+}
+
+// Same as micros16, but with the full 32-bit millisecond counter; wraps
+// after ~71.6 minutes. The shifts avoid the 32-bit library multiplication.
+OPTIMIZE_SPEED
+NO_INTERRUPTS   // interrupts are disabled during execution
+uint32_t _STM8_F(micros32)()
+{
+  register uint32_t m = _stm8_time_elapsed.value;
+  uint8_t ctr = _STM8_TIMER_COUNTER;
+  if( _STM8_TIMER_PENDING(ctr) ) _STM8_F(inc32)(m);
+
+#ifdef _STM8_SIMULATOR_
+  if( ++_STM8_TIMER_COUNTER == 0 ) _STM8_F(inc32)(m);
+#endif
+
+  m <<= 3;
+  m = ( m << 7 ) - ( m << 1 ) - m;
+  return m + _stm8_timer_ticks_to_us( ctr );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// LOCK-FREE VERSIONS, INTERRUPTS REMAIN ENABLED
+//
+// The millisecond counter is read before and after sampling the timer
+// counter and UIF; if the update ISR ran in between, both reads differ and
+// the snapshot is retried. Otherwise the counter and UIF are consistent with
+// the (unchanged) millisecond count, including a torn read of the latter.
+//
+// When called from an ISR with a higher priority than TIM4, the update ISR
+// can't run and the pending UIF is accounted for as above.
+//
+// Worst case retries: 1, as the update ISR runs only once per millisecond,
+// unless the reader itself is preempted by other ISRs for more than 1ms.
+//
+// Cycles (estimates, excl. calling overhead), per retry add the first number:
+//  millis32_lockfree   ~20
+//  micros16_lockfree   ~15 + 30
+//  micros32_lockfree   ~25 + 60
+
+OPTIMIZE_SPEED
+uint32_t _STM8_F(millis32_lockfree)()
+{
+  register uint32_t m;
+  register uint8_t uif;
+  do {
+    m   = _stm8_time_elapsed.value;
+    uif = _STM8_TIMER_SR1 & 0x01;
+  } while( m != _stm8_time_elapsed.value );
+  if( uif ) _STM8_F(inc32)(m);
+  return m;
+}
+
+OPTIMIZE_SPEED
+uint16_t _STM8_F(micros16_lockfree)()
+{
+  register uint16_t m;
+  register uint8_t ctr;
+  register bool pending;
+  do {
+    m       = _stm8_time_elapsed.w[1];       // atomic LDW
+    ctr     = _STM8_TIMER_COUNTER;
+    pending = _STM8_TIMER_PENDING(ctr);
+  } while( m != _stm8_time_elapsed.w[1] );
+  if( pending ) ++m; // 16-bit!!
+
+  m = (uint16_t)( m << 3 );
+  m = (uint16_t)( ( m << 7 ) - ( m << 1 ) - m );
+  return m + _stm8_timer_ticks_to_us( ctr );
+}
+
+OPTIMIZE_SPEED
+uint32_t _STM8_F(micros32_lockfree)()
+{
+  register uint32_t m;
+  register uint8_t ctr;
+  register bool pending;
+  do {
+    m       = _stm8_time_elapsed.value;
+    ctr     = _STM8_TIMER_COUNTER;
+    pending = _STM8_TIMER_PENDING(ctr);
+  } while( m != _stm8_time_elapsed.value );
+  if( pending ) _STM8_F(inc32)(m);
+
+  m <<= 3;
+  m = ( m << 7 ) - ( m << 1 ) - m;
+  return m + _stm8_timer_ticks_to_us( ctr );
 }
 
 _END_EXTERN_C
@@ -26,10 +26,64 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// microseconds should correspond to real time (i.e. 1000us per 1ms)
-// but each millisecond is 2.4% longer, i.e. has 1024 real microseconds:
-//  realSecondsElapsed = ourMillisElapsed >> 10;              // fast
-//  realMillisElapsed = ( ourMillisElapsed * 1000 ) >> 10;    // expensive multiplication
+// TIMER CONFIGURATION, DERIVED FROM F_CPU
+//
+// The 8-bit TIM4/TIM6 runs from fMaster / 2^PSC, with the smallest prescaler
+// that still fits a millisecond into 256 counts (i.e. best resolution).
+// If a millisecond isn't a whole number of counts, the update interrupt
+// alternates between PERIOD and PERIOD+1 counts, Bresenham-style, so that
+// the average is exact and millis/micros don't drift:
+//
+//   F_CPU    PSC   counts/ms   PERIOD  FRAC   us/count
+//    2MHz     3    250          250      0     4
+//    8MHz     5    250          250      0     4
+//   12MHz     6    187.5        187    500     5.333
+//   16MHz     6    250          250      0     4
+//   24MHz     7    187.5        187    500     5.333
+//
+// NOTE: F_CPU must be a multiple of 2^PSC for this to be exact.
+
+#if   ( (F_CPU >> 0) + 999 ) / 1000 <= 256
+# define _STM8_TIMER_PSC         0
+#elif ( (F_CPU >> 1) + 999 ) / 1000 <= 256
+# define _STM8_TIMER_PSC         1
+#elif ( (F_CPU >> 2) + 999 ) / 1000 <= 256
+# define _STM8_TIMER_PSC         2
+#elif ( (F_CPU >> 3) + 999 ) / 1000 <= 256
+# define _STM8_TIMER_PSC         3
+#elif ( (F_CPU >> 4) + 999 ) / 1000 <= 256
+# define _STM8_TIMER_PSC         4
+#elif ( (F_CPU >> 5) + 999 ) / 1000 <= 256
+# define _STM8_TIMER_PSC         5
+#elif ( (F_CPU >> 6) + 999 ) / 1000 <= 256
+# define _STM8_TIMER_PSC         6
+#elif ( (F_CPU >> 7) + 999 ) / 1000 <= 256
+# define _STM8_TIMER_PSC         7
+#else
+# error F_CPU too high for a 1ms TIM4/TIM6 period
+#endif
+
+// timer clock in Hz
+#define _STM8_TIMER_CLOCK        ( (F_CPU) >> _STM8_TIMER_PSC )
+
+#if ( _STM8_TIMER_CLOCK << _STM8_TIMER_PSC ) != (F_CPU)
+# error F_CPU must be a multiple of the TIM4/TIM6 prescaler
+#endif
+
+// whole counts per millisecond, and the remaining 1/1000ths of a count
+#define _STM8_TIMER_PERIOD       ( _STM8_TIMER_CLOCK / 1000 )
+#define _STM8_TIMER_PERIOD_FRAC  ( _STM8_TIMER_CLOCK % 1000 )
+
+// microseconds per count, 8.8 fixed point, e.g. 4.0 or 5.332
+#define _STM8_TIMER_US_Q8        ( 256000000UL / _STM8_TIMER_CLOCK )
+#define _STM8_TIMER_US_INT       ( (uint8_t)( _STM8_TIMER_US_Q8 >> 8 ) )
+#define _STM8_TIMER_US_FRAC      ( (uint8_t)( _STM8_TIMER_US_Q8 ) )
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Every millisecond has exactly 1000 microseconds, also across the
+// PERIOD/PERIOD+1 alternation. The offset within the millisecond is
+// interpolated from the timer counter with a resolution of one count.
 
 extern TINY volatile _stm8_reg32 _stm8_time_elapsed;
 
@@ -49,13 +103,33 @@ _EXTERN_C
 void _STM8_F(enable_timer)();
 
 PURE NO_INTERRUPTS uint32_t _STM8_F(millis32)();
+PURE NO_INTERRUPTS uint16_t _STM8_F(micros16)();
+// ~70 cycles incl. calling overhead (estimate)
+PURE NO_INTERRUPTS uint32_t _STM8_F(micros32)();
+
+// Same results, but without masking interrupts (no added ISR jitter);
+// they retry at most once, see timer.c
+PURE uint32_t _STM8_F(millis32_lockfree)();
+PURE uint16_t _STM8_F(micros16_lockfree)();
+PURE uint32_t _STM8_F(micros32_lockfree)();
+
+// define _STM8_TIMER_LOCKFREE to map the Arduino style API to these
+#ifdef _STM8_TIMER_LOCKFREE
+# define _STM8_TIMER_API(name) _STM8_F(name ## _lockfree)
+#else
+# define _STM8_TIMER_API(name) _STM8_F(name)
+#endif
+
 #ifndef millis
-#define millis() _STM8_F(millis32)()
+#define millis() _STM8_TIMER_API(millis32)()
 #endif
 
-PURE NO_INTERRUPTS uint16_t _STM8_F(micros16)();
 #ifndef micros
-#define micros() _STM8_F(micros16)()
+#define micros() _STM8_TIMER_API(micros16)()
+#endif
+
+#ifndef micros32
+#define micros32() _STM8_TIMER_API(micros32)()
 #endif
 
 _END_EXTERN_C
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+#
+# Decode a trace dump (trace.h, trace_dump()) into a timeline.
+#
+#   python3 trace_decode.py dump.txt
+#   python3 trace_decode.py < dump.txt
+#
+# The 16-bit cycle stamps are unwrapped assuming consecutive events are less
+# than 65536 cycles apart. Interrupt entries and exits (ids 0x80..0xBF) are
+# indented by their nesting level and show the handler's duration on exit.
+
+import sys
+
+ISR_ENTER = 0x80
+ISR_EXIT = 0xA0
+
+
+def parse(lines):
+    f_cpu, events = None, []
+    for line in lines:
+        fields = line.split()
+        if not fields:
+            continue
+        if fields[0] == 'TRACE':
+            f_cpu, events = int(fields[1]), []
+        elif fields[0] == 'END':
+            break
+        elif f_cpu is not None and len(fields) == 3:
+            events.append(tuple(int(x, 16) for x in fields))
+    if f_cpu is None:
+        sys.exit('no TRACE header found')
+    return f_cpu, events
+
+
+def decode(f_cpu, events, out=sys.stdout):
+    t, last, stack = 0, None, []
+    for id, arg, cycles in events:
+        if last is not None:
+            t += (cycles - last) & 0xFFFF
+        last = cycles
+        us = t * 1e6 / f_cpu
+        indent = '  ' * len(stack)
+
+        if ISR_ENTER <= id < ISR_EXIT:
+            out.write('%10.2fus %s> ISR %d\n' % (us, indent, id - ISR_ENTER))
+            stack.append((id - ISR_ENTER, t))
+        elif ISR_EXIT <= id < ISR_EXIT + 0x20:
+            vector = id - ISR_EXIT
+            if stack and stack[-1][0] == vector:
+                start = stack.pop()[1]
+                indent = '  ' * len(stack)
+                out.write('%10.2fus %s< ISR %d, %d cycles (%.2fus)\n' % (
+                    us, indent, vector, t - start, (t - start) * 1e6 / f_cpu))
+            else:
+                out.write('%10.2fus %s< ISR %d (entry not in trace)\n' % (
+                    us, indent, vector))
+        else:
+            out.write('%10.2fus %sevent 0x%02X arg 0x%02X\n' % (
+                us, indent, id, arg))
+
+
+def main():
+    lines = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    f_cpu, events = parse(lines)
+    decode(f_cpu, events)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,80 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#define _STM8HAL_INTERNAL
+
+#include "stm8hal.h"
+#include "trace.h"
+
+#include <stdio.h>
+
+_STM8_T(trace_event) _stm8_trace_buffer[ _STM8_TRACE_SIZE ];
+TINY uint8_t _stm8_trace_head = 0;
+TINY bool    _stm8_trace_stopped = true;  // until trace_start()
+
+_EXTERN_C
+
+OPTIMIZE_SIZE
+void _STM8_F(trace_stop)(void)
+{
+  _stm8_trace_stopped = true;
+}
+
+OPTIMIZE_SIZE
+NO_INTERRUPTS   // interrupts are disabled during execution
+void _STM8_F(trace_start)(void)
+{
+  for( uint16_t i=0; i<_STM8_TRACE_SIZE; ++i)
+    _stm8_trace_buffer[i].id = _STM8_TRACE_UNUSED;
+  _stm8_trace_head = 0;
+  _stm8_trace_stopped = false;
+}
+
+// Format, one line each:
+//   TRACE <F_CPU> <number of events>
+//   <id> <arg> <cycles>         hex, oldest first
+//   END
+OPTIMIZE_SIZE
+void _STM8_F(trace_dump)(void)
+{
+  _STM8_F(trace_stop)();
+
+  const uint8_t head = _stm8_trace_head;
+
+  uint16_t n = 0;
+  for( uint16_t i=0; i<_STM8_TRACE_SIZE; ++i)
+    if( _stm8_trace_buffer[i].id != _STM8_TRACE_UNUSED ) ++n;
+
+  printf( "TRACE %lu %u\n", (unsigned long)F_CPU, n );
+  for( uint16_t i=0; i<_STM8_TRACE_SIZE; ++i)
+  {
+    const _STM8_T(trace_event) * e =
+      &_stm8_trace_buffer[ (uint8_t)( head + i ) & ( _STM8_TRACE_SIZE - 1 ) ];
+    if( e->id == _STM8_TRACE_UNUSED ) continue;
+    printf( "%02X %02X %04X\n", e->id, e->arg, e->cycles );
+  }
+  printf( "END\n" );
+}
+
+_END_EXTERN_C
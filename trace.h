@@ -0,0 +1,122 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_TRACE_H
+#define __STM8HAL_TRACE_H
+
+#include "debug.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// EVENT TRACE
+//
+// TRACE(id, arg) stores {id, arg, 16-bit cycle count} in a ring buffer in RAM,
+// keeping the last _STM8_TRACE_SIZE events. It costs ~20 cycles, interrupts
+// are only disabled to claim a slot and take the time stamp, so it can be
+// used anywhere, including nested interrupt handlers.
+//
+// Define _STM8_TRACE to compile the TRACE macros in, and start the debug.h
+// cycle counter with enableCycleCounter().
+//
+// Recording begins with trace_start(). After a glitch, trace_stop() freezes
+// the buffer and trace_dump() prints it with printf(), for
+// tools/trace_decode.py to turn into a timeline. Events must be less than
+// 65536 cycles apart (~4ms at 16MHz), longer gaps can't be told from shorter
+// ones and show up modulo 65536.
+//
+// Ids 0x00..0x7F are free for the application, ids 0x80..0xBF mark the entry
+// and exit of interrupt handlers (TRACE_ISR_ENTER/EXIT), so the decoder can
+// show the nesting and duration of interrupts.
+
+#ifndef _STM8_TRACE_SIZE
+#define _STM8_TRACE_SIZE        64      // power of 2, 4 bytes per event
+#endif
+
+#if ( _STM8_TRACE_SIZE & ( _STM8_TRACE_SIZE - 1 ) ) || _STM8_TRACE_SIZE > 256
+#error _STM8_TRACE_SIZE must be a power of 2, 256 max
+#endif
+
+#define _STM8_TRACE_ISR_ENTER   0x80    // | vector
+#define _STM8_TRACE_ISR_EXIT    0xA0    // | vector
+#define _STM8_TRACE_UNUSED      0xFF    // empty slot
+
+_EXTERN_C
+
+typedef struct
+{
+  uint8_t  id;
+  uint8_t  arg;
+  uint16_t cycles;
+}
+_STM8_T(trace_event);
+
+extern _STM8_T(trace_event) _stm8_trace_buffer[ _STM8_TRACE_SIZE ];
+extern TINY uint8_t _stm8_trace_head;   // next slot, counts all events
+extern TINY bool    _stm8_trace_stopped;
+
+// Stop recording, e.g. when a glitch was detected.
+void _STM8_F(trace_stop)(void);
+
+// Clear the buffer and start recording.
+void _STM8_F(trace_start)(void);
+
+// Print the buffer, oldest event first; stops recording.
+void _STM8_F(trace_dump)(void);
+
+_END_EXTERN_C
+
+#ifdef __cplusplus
+
+OPTIMIZE_SPEED
+ALWAYS_INLINE
+inline void _STM8_F(trace)(uint8_t id, uint8_t arg)
+{
+  if( _stm8_trace_stopped ) return;
+
+  uint16_t cycles;
+  uint8_t i;
+  {
+    Mutex m;
+    cycles = _STM8_F(cycles16)();
+    i = _stm8_trace_head++;
+  }
+  _STM8_T(trace_event) * e = &_stm8_trace_buffer[ i & ( _STM8_TRACE_SIZE - 1 ) ];
+  e->id = id;
+  e->arg = arg;
+  e->cycles = cycles;
+}
+
+#endif // __cplusplus
+
+#if defined(_STM8_TRACE) && defined(__cplusplus)
+#define TRACE(id, arg)          _STM8_F(trace)( (id), (arg) )
+#define TRACE_ISR_ENTER(vector) _STM8_F(trace)( _STM8_TRACE_ISR_ENTER | (vector), 0 )
+#define TRACE_ISR_EXIT(vector)  _STM8_F(trace)( _STM8_TRACE_ISR_EXIT | (vector), 0 )
+#else
+#define TRACE(id, arg)          do {} while(0)
+#define TRACE_ISR_ENTER(vector) do {} while(0)
+#define TRACE_ISR_EXIT(vector)  do {} while(0)
+#endif
+
+#endif // __STM8HAL_TRACE_H
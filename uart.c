@@ -0,0 +1,253 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+
+#define _STM8HAL_INTERNAL
+
+#include <stdio.h>
+
+#include "stm8hal.h"
+#include "isrstat.h"
+#include "uart.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// UART1 and UART2 share the register layout; devices have one or the other
+// (UART3 of the high density lines is not covered).
+//
+#if defined(__ICCSTM8__)
+
+# if !defined(_STM8_UART)
+#  if defined(UART1_R_RXNE_vector)
+#   define _STM8_UART 1
+#  elif defined(UART2_R_RXNE_vector)
+#   define _STM8_UART 2
+#  endif
+# endif
+# define _STM8_UART_NAME         _GLUE( UART, _STM8_UART )
+# define _STM8_UART_TX_VECTOR    _GLUE( _STM8_UART_NAME, _T_TXE_vector )
+# define _STM8_UART_RX_VECTOR    _GLUE( _STM8_UART_NAME, _R_RXNE_vector )
+# define _STM8_UART_SR           _GLUE( _STM8_UART_NAME, _SR )    // TXE 0x80, TC 0x40, RXNE 0x20, OR 0x08
+# define _STM8_UART_DR           _GLUE( _STM8_UART_NAME, _DR )
+# define _STM8_UART_BRR1         _GLUE( _STM8_UART_NAME, _BRR1 )
+# define _STM8_UART_BRR2         _GLUE( _STM8_UART_NAME, _BRR2 )
+# define _STM8_UART_CR1          _GLUE( _STM8_UART_NAME, _CR1 )
+# define _STM8_UART_CR2          _GLUE( _STM8_UART_NAME, _CR2 )   // TIEN 0x80, RIEN 0x20, TEN 0x08, REN 0x04
+# define _STM8_UART_CR3          _GLUE( _STM8_UART_NAME, _CR3 )
+
+#else // check for STM's system header defines
+
+# if !defined(_STM8_UART)
+#  if defined(UART1)
+#   define _STM8_UART 1
+#  elif defined(UART2)
+#   define _STM8_UART 2
+#  endif
+# endif
+# define _STM8_UART_NAME         _GLUE( UART, _STM8_UART )
+# define _STM8_UART_TX_VECTOR    _Pragma("error Unsupported compiler")
+# define _STM8_UART_RX_VECTOR    _Pragma("error Unsupported compiler")
+# define _STM8_UART_SR           _GLUE( _STM8_UART_NAME, ->SR )
+# define _STM8_UART_DR           _GLUE( _STM8_UART_NAME, ->DR )
+# define _STM8_UART_BRR1         _GLUE( _STM8_UART_NAME, ->BRR1 )
+# define _STM8_UART_BRR2         _GLUE( _STM8_UART_NAME, ->BRR2 )
+# define _STM8_UART_CR1          _GLUE( _STM8_UART_NAME, ->CR1 )
+# define _STM8_UART_CR2          _GLUE( _STM8_UART_NAME, ->CR2 )
+# define _STM8_UART_CR3          _GLUE( _STM8_UART_NAME, ->CR3 )
+
+#endif
+
+#if !defined(_STM8_UART)
+# error No UART1 or UART2 on this device
+#elif _STM8_UART != 1 && _STM8_UART != 2
+# error _STM8_UART must be 1 or 2
+#endif
+
+// PCKEN13 gates UART1 or UART2 on the low and medium density parts; only
+// the high density ones (STM8S207/208, with UART3 on PCKEN13) have UART1 on
+// PCKEN12.
+#define _STM8_UART_CGR          CLK_PCKENR1     // clock gating register
+#if _STM8_UART == 1 && ( defined(UART3_R_RXNE_vector) || defined(UART3) )
+# define _STM8_UART_CGR_MASK    (1<<2)
+#else
+# define _STM8_UART_CGR_MASK    (1<<3)
+#endif
+
+#define _STM8_UART_TIEN         0x80
+#define _STM8_UART_RIEN         0x20
+#define _STM8_UART_TEN          0x08
+#define _STM8_UART_REN          0x04
+
+#define _STM8_UART_TXE          0x80
+#define _STM8_UART_TC           0x40
+#define _STM8_UART_OR           0x08
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint8_t _stm8_uart_tx_buffer[ _STM8_UART_TX_SIZE ];
+uint8_t _stm8_uart_rx_buffer[ _STM8_UART_RX_SIZE ];
+TINY volatile uint8_t _stm8_uart_tx_head = 0;
+TINY volatile uint8_t _stm8_uart_tx_tail = 0;
+TINY volatile uint8_t _stm8_uart_rx_head = 0;
+TINY volatile uint8_t _stm8_uart_rx_tail = 0;
+TINY volatile uint8_t _stm8_uart_rx_lost = 0;
+
+_EXTERN_C
+
+// Interrupt handler for the transmit data register empty flag. TIEN is set
+// by uart_write() after queueing, and cleared here when the buffer runs dry.
+OPTIMIZE_SPEED
+INTERRUPT( _STM8_UART_TX_VECTOR )
+void _stm8_uart_tx(void)
+{
+  ISR_ENTER( _STM8_UART_TX_VECTOR );
+
+  register uint8_t tail = _stm8_uart_tx_tail;
+  if( tail != _stm8_uart_tx_head )
+  {
+    _STM8_UART_DR = _stm8_uart_tx_buffer[ tail & ( _STM8_UART_TX_SIZE - 1 ) ];
+    _stm8_uart_tx_tail = ++tail;
+  }
+  if( tail == _stm8_uart_tx_head )
+    _STM8_UART_CR2 &= ~_STM8_UART_TIEN;
+
+  ISR_EXIT( _STM8_UART_TX_VECTOR );
+}
+
+// Interrupt handler for received data, and overrun. Reading SR, then DR
+// clears both flags.
+OPTIMIZE_SPEED
+INTERRUPT( _STM8_UART_RX_VECTOR )
+void _stm8_uart_rx(void)
+{
+  ISR_ENTER( _STM8_UART_RX_VECTOR );
+
+  const uint8_t sr = _STM8_UART_SR;
+  const uint8_t c = _STM8_UART_DR;
+  register uint8_t head = _stm8_uart_rx_head;
+
+  if( sr & _STM8_UART_OR )
+    ++_stm8_uart_rx_lost;
+  if( (uint8_t)( head - _stm8_uart_rx_tail ) < _STM8_UART_RX_SIZE )
+  {
+    _stm8_uart_rx_buffer[ head & ( _STM8_UART_RX_SIZE - 1 ) ] = c;
+    _stm8_uart_rx_head = ++head;
+  }
+  else
+    ++_stm8_uart_rx_lost;
+
+  ISR_EXIT( _STM8_UART_RX_VECTOR );
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(uart_init)(uint16_t div)
+{
+  _STM8_UART_CGR |= _STM8_UART_CGR_MASK;
+  _STM8_UART_CR2 = 0;
+
+  _stm8_uart_tx_head = _stm8_uart_tx_tail = 0;
+  _stm8_uart_rx_head = _stm8_uart_rx_tail = 0;
+  _stm8_uart_rx_lost = 0;
+
+  _STM8_UART_CR1 = 0;                   // 8 data bits, no parity
+  _STM8_UART_CR3 = 0;                   // 1 stop bit
+  // BRR2 first, the divider is latched with the write to BRR1
+  _STM8_UART_BRR2 = (uint8_t)( ( ( div >> 8 ) & 0xF0 ) | ( div & 0x0F ) );
+  _STM8_UART_BRR1 = (uint8_t)( div >> 4 );
+
+  _STM8_UART_CR2 = _STM8_UART_TEN | _STM8_UART_REN | _STM8_UART_RIEN;
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(uart_end)(void)
+{
+  _STM8_UART_CR2 = 0;
+  _stm8_uart_tx_tail = _stm8_uart_tx_head;
+  _stm8_uart_rx_tail = _stm8_uart_rx_head;
+}
+
+OPTIMIZE_SPEED
+void _STM8_F(uart_write)(uint8_t c)
+{
+  register uint8_t head = _stm8_uart_tx_head;
+  while( (uint8_t)( head - _stm8_uart_tx_tail ) >= _STM8_UART_TX_SIZE )
+  {
+    wdg();
+    yield();
+  }
+  _stm8_uart_tx_buffer[ head & ( _STM8_UART_TX_SIZE - 1 ) ] = c;
+  _stm8_uart_tx_head = ++head;          // publish after the data
+  _STM8_UART_CR2 |= _STM8_UART_TIEN;    // BSET, atomic
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(uart_write_buffer)(const uint8_t * buf, uint8_t n)
+{
+  while( n-- )
+    _STM8_F(uart_write)( *buf++ );
+}
+
+OPTIMIZE_SIZE
+void _STM8_F(uart_flush)(void)
+{
+  if( !( _STM8_UART_CR2 & _STM8_UART_TEN ) ) return;
+  while( _stm8_uart_tx_tail != _stm8_uart_tx_head || !( _STM8_UART_SR & _STM8_UART_TC ) )
+  {
+    wdg();
+    yield();
+  }
+}
+
+OPTIMIZE_SPEED
+int16_t _STM8_F(uart_read)(void)
+{
+  register uint8_t tail = _stm8_uart_rx_tail;
+  if( tail == _stm8_uart_rx_head ) return -1;
+  const uint8_t c = _stm8_uart_rx_buffer[ tail & ( _STM8_UART_RX_SIZE - 1 ) ];
+  _stm8_uart_rx_tail = ++tail;          // release the slot after reading it
+  return c;
+}
+
+#if defined(_STM8_UART_STDIO)
+
+int putchar(int c)
+{
+  _STM8_F(uart_write)( (uint8_t)c );
+  return c;
+}
+
+#if defined(__ICCSTM8__)
+// DLIB low level output, used by printf() and puts()
+size_t __write(int handle, const unsigned char * buf, size_t n)
+{
+  if( buf == NULL ) return 0;           // flush request
+  if( handle != 1 && handle != 2 ) return (size_t)-1;   // stdout, stderr
+  for( size_t i = 0; i < n; ++i )
+    _STM8_F(uart_write)( buf[i] );
+  return n;
+}
+#endif
+
+#endif // _STM8_UART_STDIO
+
+_END_EXTERN_C
@@ -0,0 +1,120 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+
+#ifndef __STM8HAL_UART_H
+#define __STM8HAL_UART_H
+
+#include "stm8hal.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// BUFFERED UART
+//
+// Interrupt driven UART1 or UART2, whichever the device has, or the one
+// selected with _STM8_UART (1 or 2).
+// uart_write() only copies into the transmit buffer and returns, the TXE
+// interrupt moves the bytes to the data register; the RXNE interrupt fills
+// the receive buffer for uart_read().
+//
+// Each buffer has a single producer and a single consumer, the main loop on
+// one side and the interrupt handler on the other, with free running 8-bit
+// indices that only their owner writes, so no locks are needed. Calling
+// uart_write() or uart_read() from interrupt handlers is not supported.
+//
+// When the transmit buffer is full, uart_write() waits and calls yield().
+// Define _STM8_UART_STDIO to have putchar() and printf() go through it.
+
+#ifndef _STM8_UART_TX_SIZE
+#define _STM8_UART_TX_SIZE      64      // power of 2, 128 max
+#endif
+
+#ifndef _STM8_UART_RX_SIZE
+#define _STM8_UART_RX_SIZE      16      // power of 2, 128 max
+#endif
+
+#if ( _STM8_UART_TX_SIZE & ( _STM8_UART_TX_SIZE - 1 ) ) || _STM8_UART_TX_SIZE > 128
+#error _STM8_UART_TX_SIZE must be a power of 2, 128 max
+#endif
+
+#if ( _STM8_UART_RX_SIZE & ( _STM8_UART_RX_SIZE - 1 ) ) || _STM8_UART_RX_SIZE > 128
+#error _STM8_UART_RX_SIZE must be a power of 2, 128 max
+#endif
+
+// Baud rate divider, rounded to nearest, 16 to 0xFFFF
+#define _STM8_UART_DIV(baud)    ( (uint16_t)( ( (F_CPU) + (baud) / 2 ) / (baud) ) )
+
+_EXTERN_C
+
+extern uint8_t _stm8_uart_tx_buffer[ _STM8_UART_TX_SIZE ];
+extern uint8_t _stm8_uart_rx_buffer[ _STM8_UART_RX_SIZE ];
+extern TINY volatile uint8_t _stm8_uart_tx_head;     // written by uart_write()
+extern TINY volatile uint8_t _stm8_uart_tx_tail;     // written by the TXE ISR
+extern TINY volatile uint8_t _stm8_uart_rx_head;     // written by the RXNE ISR
+extern TINY volatile uint8_t _stm8_uart_rx_tail;     // written by uart_read()
+extern TINY volatile uint8_t _stm8_uart_rx_lost;     // bytes dropped, full buffer or overrun
+
+// Enable the UART, 8N1, with a divider of F_CPU / baud, see uart_begin().
+void _STM8_F(uart_init)(uint16_t div);
+
+// Disable the UART, pending bytes are dropped.
+void _STM8_F(uart_end)(void);
+
+// Queue a byte for transmission, waits while the buffer is full.
+void _STM8_F(uart_write)(uint8_t c);
+
+// Queue n bytes.
+void _STM8_F(uart_write_buffer)(const uint8_t * buf, uint8_t n);
+
+// Wait until the last byte has left the shift register.
+void _STM8_F(uart_flush)(void);
+
+// The next received byte, or -1 when none is available.
+int16_t _STM8_F(uart_read)(void);
+
+// Number of received bytes waiting.
+ALWAYS_INLINE
+inline uint8_t _STM8_F(uart_available)(void)
+{
+  return (uint8_t)( _stm8_uart_rx_head - _stm8_uart_rx_tail );
+}
+
+// Free space in the transmit buffer, uart_write() won't wait for that many.
+ALWAYS_INLINE
+inline uint8_t _STM8_F(uart_writable)(void)
+{
+  return _STM8_UART_TX_SIZE - (uint8_t)( _stm8_uart_tx_head - _stm8_uart_tx_tail );
+}
+
+// Enable the UART at a baud rate; for a constant baud rate the divider is
+// computed at compile time.
+ALWAYS_INLINE
+inline void _STM8_F(uart_begin)(uint32_t baud)
+{
+  _STM8_F(uart_init)( _STM8_UART_DIV(baud) );
+}
+
+_END_EXTERN_C
+
+#endif // __STM8HAL_UART_H
@@ -81,6 +81,13 @@ _STM8_DEF_PIN(B,5); _STM8_DEF_PIN(B,4);
 _STM8_DEF_PIN(C,3); _STM8_DEF_PIN(C,4); _STM8_DEF_PIN(C,5); _STM8_DEF_PIN(C,6); _STM8_DEF_PIN(C,7);
 _STM8_DEF_PIN(D,1); _STM8_DEF_PIN(D,2); _STM8_DEF_PIN(D,3); _STM8_DEF_PIN(D,4); _STM8_DEF_PIN(D,5); _STM8_DEF_PIN(D,6);
 
+// pin number to port block and bit, in STM8PortPin order (digital.h)
+#define _STM8_PIN_MAP(X) \
+	X(A,1) X(A,2) X(A,3) \
+	X(B,5) X(B,4) \
+	X(C,3) X(C,4) X(C,5) X(C,6) X(C,7) \
+	X(D,1) X(D,2) X(D,3) X(D,4) X(D,5) X(D,6)
+
 #define PIN_SPI_SS          (PA3)
 #define PIN_SPI_MOSI        (PC6)
 #define PIN_SPI_MISO        (PC7)
@@ -74,6 +74,15 @@ _STM8_DEF_PIN(E,5);
 _STM8_DEF_PIN(C,1); _STM8_DEF_PIN(C,2); _STM8_DEF_PIN(C,3); _STM8_DEF_PIN(C,4); _STM8_DEF_PIN(C,5); _STM8_DEF_PIN(C,6); _STM8_DEF_PIN(C,7);
 _STM8_DEF_PIN(D,0); _STM8_DEF_PIN(D,1); _STM8_DEF_PIN(D,2); _STM8_DEF_PIN(D,3); _STM8_DEF_PIN(D,4); _STM8_DEF_PIN(D,5); _STM8_DEF_PIN(D,6); _STM8_DEF_PIN(D,7);
 
+// pin number to port block and bit, in STM8PortPin order (digital.h)
+#define _STM8_PIN_MAP(X) \
+	X(A,1) X(A,2) X(A,3) \
+	X(F,4) \
+	X(B,7) X(B,6) X(B,5) X(B,4) X(B,3) X(B,2) X(B,1) X(B,0) \
+	X(E,5) \
+	X(C,1) X(C,2) X(C,3) X(C,4) X(C,5) X(C,6) X(C,7) \
+	X(D,0) X(D,1) X(D,2) X(D,3) X(D,4) X(D,5) X(D,6) X(D,7)
+
 #define PIN_SPI_SS          (PA3)
 #define PIN_SPI_MOSI        (PC6)
 #define PIN_SPI_MISO        (PC7)
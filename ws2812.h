@@ -0,0 +1,181 @@
+/*******************************************************************************
+
+Copyright (c) 2017-present J Thiel
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef __STM8HAL_WS2812_H
+#define __STM8HAL_WS2812_H
+
+#include "pin.h"
+#include "delay.h"
+#include "math.h"
+
+#if defined(__cplusplus)
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// WS2812 / SK6812 LED STRIP OUTPUT
+//
+// Bit-banged on a FastPin, with the bit timing derived from F_CPU at compile
+// time. Each bit is
+//
+//   BSET  ODR           rising edge                      1cy
+//   SLL   VR            next bit into carry               1cy
+//   nops<A>
+//   BCCM  ODR           falls here for a 0 (T0H)          1cy
+//   nops<B>
+//   BRES  ODR           falls here for a 1 (T1H)          1cy
+//   nops<C>             low until the next bit
+//
+// BCCM copies the carry to the pin, so there's no branch and both bit values
+// take exactly the same time. nops<> preserves the carry flag.
+//
+//   F_CPU   WS2812 T0H/T1H/bit      SK6812 T0H/T1H/bit
+//    8MHz   375 / 750 / 1250ns      250 / 625 / 1250ns
+//   12MHz   333 / 750 / 1250ns      333 / 583 / 1250ns
+//   16MHz   375 / 750 / 1250ns      312 / 625 / 1250ns
+//   24MHz   333 / 750 / 1250ns      292 / 583 / 1250ns
+//
+// The timing is checked against the datasheet limits by static_assert for
+// the configured F_CPU, from the instruction timings; it's worth a look with
+// a logic analyzer on new hardware, as instruction fetch can stall.
+//
+// Between bytes the low time of the last bit grows by a few cycles, between
+// LEDs by the brightness scaling (~25 cycles per channel) and any interrupt
+// handler, as interrupts are only disabled while an LED's bits are sent.
+// Handlers running between LEDs must be shorter than the latch time (50us),
+// or define _STM8_WS2812_FRAME_ATOMIC to disable interrupts for the frame.
+// A frame takes ~30us per RGB LED; an atomic frame longer than 1ms (~33
+// LEDs) delays the timer interrupt past the next tick, and millis loses it.
+//
+// The data is sent as stored, i.e. in the strip's order (GRB for WS2812,
+// GRBW for SK6812 RGBW). The optional brightness is applied while sending,
+// without a second buffer.
+//
+// NOTE: Uses VR[0] (stm8hal.h) as the shift register.
+
+// timings in ns; T0H, T1H as targets, limits as guaranteed by the parts
+struct _STM8_T(ws2812_timing)
+{
+  enum { T0H = 350, T1H = 750, BIT = 1250,
+         T0H_MIN = 200, T0H_MAX = 450, T1H_MIN = 650, T1H_MAX = 1000, TL_MIN = 450 };
+};
+
+struct _STM8_T(sk6812_timing)
+{
+  enum { T0H = 300, T1H = 600, BIT = 1250,
+         T0H_MIN = 150, T0H_MAX = 450, T1H_MIN = 450, T1H_MAX = 750, TL_MIN = 450 };
+};
+
+#ifndef _STM8_WS2812_LATCH_US
+#define _STM8_WS2812_LATCH_US   300     // WS2812B: 280us, SK6812: 80us
+#endif
+
+// ns to cycles, rounded
+#define _STM8_NS_ROUND(ns) \
+  ( ( (uint32_t)(ns) * ( (F_CPU) / 1000UL ) + 500000UL ) / 1000000UL )
+
+// cycles to ns, for the checks
+#define _STM8_CYCLES_NS(cycles) \
+  ( (uint32_t)(cycles) * 1000000UL / ( (F_CPU) / 1000UL ) )
+
+template< uint8_t PIN, uint8_t CHANNELS = 3, typename T = _STM8_T(ws2812_timing) >
+struct _STM8_T(ws2812)
+{
+  enum
+  {
+    T0H = _STM8_NS_ROUND( T::T0H ),
+    T1H = _STM8_NS_ROUND( T::T1H ),
+    BIT = _STM8_NS_ROUND( T::BIT ),
+    A = T0H - 2,                // BSET, SLL
+    B = T1H - T0H - 1,          // BCCM
+    C = BIT - T1H - 1           // BRES
+  };
+
+  STATIC_ASSERT( A >= 0 && B >= 0 && C >= 0, "F_CPU too low for this LED type" );
+  STATIC_ASSERT( _STM8_CYCLES_NS(T0H) >= T::T0H_MIN && _STM8_CYCLES_NS(T0H) <= T::T0H_MAX, "T0H out of range" );
+  STATIC_ASSERT( _STM8_CYCLES_NS(T1H) >= T::T1H_MIN && _STM8_CYCLES_NS(T1H) <= T::T1H_MAX, "T1H out of range" );
+  STATIC_ASSERT( _STM8_CYCLES_NS(BIT - T1H) >= T::TL_MIN, "T1L out of range" );
+  STATIC_ASSERT( CHANNELS == 3 || CHANNELS == 4, "3 or 4 channels" );
+
+  static void begin()
+  {
+    FastPin<PIN>::setOutput(PushPull_Fast);
+    FastPin<PIN>::lo();
+  }
+
+  // send leds * CHANNELS bytes, scaled by brightness (255 = as is),
+  // then wait for the strip to latch
+  static void show( const uint8_t * data, uint16_t leds, fract8 brightness = 255 )
+  {
+    {
+#ifdef _STM8_WS2812_FRAME_ATOMIC
+      Mutex frame;
+#endif
+      uint8_t c[ CHANNELS ];
+      for( ; leds; --leds, data += CHANNELS )
+      {
+        for( uint8_t i=0; i<CHANNELS; ++i)
+        {
+          // round mode (3), see math.h: 0 stays 0, 255 leaves data unchanged
+          c[i] = brightness == 255 ? data[i]
+               : _STM8_F(scale_add8)( data[i], brightness, data[i] );
+        }
+        Mutex led;
+        send( c[0] );
+        send( c[1] );
+        send( c[2] );
+        if( CHANNELS == 4 ) send( c[3] );
+      }
+    }
+    // interrupts are back on, the latch time may run long
+    _STM8_F(delay_us16)( _STM8_WS2812_LATCH_US );
+  }
+
+private:
+  ALWAYS_INLINE
+  static inline void bit()
+  {
+    FastPin<PIN>::hi();
+    asm("SLL   s:VR");          // bit 7 into carry
+    _STM8_F(nops)< A >();
+    FastPin<PIN>::bccm();       // low for a 0
+    _STM8_F(nops)< B >();
+    FastPin<PIN>::lo();
+    _STM8_F(nops)< C >();
+  }
+
+  ALWAYS_INLINE
+  static inline void send( uint8_t b )
+  {
+    VR[0] = b;
+    bit(); bit(); bit(); bit();
+    bit(); bit(); bit(); bit();
+  }
+};
+
+#undef _STM8_NS_ROUND
+#undef _STM8_CYCLES_NS
+
+#endif // __cplusplus
+
+#endif // __STM8HAL_WS2812_H